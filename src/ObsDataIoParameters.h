@@ -16,6 +16,7 @@
 #include "ioda/Engines/EngineUtils.h"
 #include "ioda/Engines/ReaderBase.h"
 #include "ioda/Engines/WriterBase.h"
+#include "ioda/Io/IoPoolParameters.h"
 
 namespace ioda {
 
@@ -85,6 +86,42 @@ class ObsDataInParameters : public oops::Parameters {
 
     /// maximum frame size
     oops::Parameter<int> maxFrameSize{"max frame size", DefaultFrameSize, this};
+
+    /// memory budget in bytes for one frame. When specified, the number of locations per
+    /// frame is derived from the bytes needed to hold one location of the variables being
+    /// read, and "max frame size" is ignored.
+    oops::OptionalParameter<std::size_t> maxFrameBytes{"max frame bytes", this};
+
+    /// variables to read from the obs source, given as group/name with glob style
+    /// wildcards allowed (eg, "MetaData/*", "*/brightnessTemperature"). All variables
+    /// are read when this is not specified.
+    oops::OptionalParameter<std::vector<std::string>> includeVariables{
+        "include variables", this};
+
+    /// variables not to read from the obs source, given as group/name with glob style
+    /// wildcards allowed. Applied after "include variables".
+    oops::OptionalParameter<std::vector<std::string>> excludeVariables{
+        "exclude variables", this};
+
+    /// read only the locations kept on this process (after the MPI distribution
+    /// has been applied) for variables other than the location metadata
+    oops::Parameter<bool> readOwnedLocationsOnly{"read owned locations only", true, this};
+
+    /// read pool specification. When present, only a subset of the processes (the read
+    /// pool) read variable data from the backend and pass it on to the other processes.
+    oops::OptionalParameter<IoPoolParameters> ioPool{"io pool", this};
+
+    /// read the next frame on a background thread while the current frame is
+    /// being processed (not used together with the read pool)
+    oops::Parameter<bool> prefetchFrames{"prefetch frames", false, this};
+
+    /// number of threads used to store the variables of each frame in the ObsSpace
+    oops::Parameter<int> ingestThreads{"ingest threads", 1, this};
+
+    /// defer reading variables other than the location metadata until they are first
+    /// accessed through the ObsSpace (requires "read owned locations only", not used
+    /// together with the read pool, prefetch frames or obs extension)
+    oops::Parameter<bool> lazyLoading{"lazy loading", false, this};
 };
 
 class ObsDataOutParameters : public oops::Parameters {
@@ -93,6 +130,12 @@ class ObsDataOutParameters : public oops::Parameters {
  public:
     /// option controlling the creation of the backend
     oops::RequiredParameter<Engines::WriterParametersWrapper> engine{"engine", this};
+
+    /// write the output file on a background thread from a copy of the obs space data,
+    /// so that save() returns before the file is complete (see ObsSpace::waitForSave).
+    /// Requires an MPI library initialized with MPI_THREAD_MULTIPLE and a thread safe
+    /// HDF5 library; the output is written synchronously otherwise.
+    oops::Parameter<bool> asyncSave{"asynchronous save", false, this};
 };
 
 }  // namespace ioda
@@ -8,11 +8,16 @@
 #include "ioda/ObsSpace.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <fstream>
+#include <functional>
+#include <future>
+#include <hdf5.h>
 #include <iomanip>
 #include <map>
 #include <memory>
+#include <mpi.h>
 #include <set>
 #include <string>
 #include <utility>
@@ -61,6 +66,65 @@ bool extractChannelSuffixIfPresent(const std::string &name,
     return false;
 }
 
+// Run the tasks on up to numThreads threads, the calling thread included. An exception thrown
+// by a task is passed on to the caller once all the threads have finished.
+void runTasks(const std::vector<std::function<void()>> & tasks, std::size_t numThreads) {
+    numThreads = std::min(numThreads, tasks.size());
+    std::atomic<std::size_t> nextTask(0);
+    auto worker = [&tasks, &nextTask]() {
+        for (std::size_t i = nextTask++; i < tasks.size(); i = nextTask++) {
+            tasks[i]();
+        }
+    };
+
+    std::vector<std::future<void>> workers;
+    for (std::size_t i = 1; i < numThreads; ++i) {
+        workers.push_back(std::async(std::launch::async, worker));
+    }
+    try {
+        worker();
+    } catch (...) {
+        for (auto & w : workers) {
+            w.wait();
+        }
+        throw;
+    }
+    for (auto & w : workers) {
+        w.get();
+    }
+}
+
+// Completion of the most recent asynchronous save of any obs space. Each asynchronous save
+// waits for the previous one so that the output files are written one at a time, in the
+// order the saves were started.
+std::shared_future<void> & lastAsyncSave() {
+    static std::shared_future<void> lastSave;
+    return lastSave;
+}
+
+// Return true if MPI calls can be made from a background thread while the main thread
+// keeps using MPI.
+bool mpiSupportsConcurrentThreads() {
+    int provided = MPI_THREAD_SINGLE;
+    MPI_Query_thread(&provided);
+    return provided == MPI_THREAD_MULTIPLE;
+}
+
+// Return true if HDF5 calls can be made from a background thread while the main thread
+// keeps accessing other files.
+bool hdf5IsThreadSafe() {
+    hbool_t threadSafe = 0;
+    H5is_library_threadsafe(&threadSafe);
+    return threadSafe > 0;
+}
+
+// Return a new name for the communicator of an asynchronous save. The names only need to be
+// unique on each process, and every process starts the saves in the same order.
+std::string nextSaveCommName() {
+    static std::size_t numSaveComms = 0;
+    return "ioda_async_save_" + std::to_string(numSaveComms++);
+}
+
 }  // namespace
 
 // ----------------------------- public functions ------------------------------
@@ -225,25 +289,110 @@ ObsSpace::ObsSpace(const Parameters_ & params, const eckit::mpi::Comm & comm,
     oops::Log::trace() << "ObsSpace::ObsSpace constructed name = " << obsname() << std::endl;
 }
 
+// -----------------------------------------------------------------------------
+ObsSpace::~ObsSpace() {
+    // The background write uses the io pool and the parameters of this obs space, so it
+    // needs to be done before they go away.
+    if (save_future_.valid()) {
+        save_future_.wait();
+    }
+    if (save_pool_ != nullptr) {
+        save_pool_->finalize();
+    }
+    if (!save_comm_name_.empty()) {
+        eckit::mpi::deleteComm(save_comm_name_.c_str());
+    }
+}
+
 // -----------------------------------------------------------------------------
 void ObsSpace::save() {
+    // Finish a previous save before starting another one
+    waitForSave();
+
     if (obs_params_.top_level_.obsDataOut.value() != boost::none) {
-        // Write the output file
-        IoPool obsPool(obs_params_.top_level_.ioPool,
+        // Variables deferred by lazy loading need to be in obs_group_ to be written out.
+        loadAllLazyVars();
+
+        bool asyncSave = obs_params_.top_level_.obsDataOut.value()->asyncSave;
+        if (asyncSave && !asyncSaveSupported()) {
+            oops::Log::warning() << obsname() << ": MPI does not support concurrent threads"
+                                 << " or HDF5 is not thread safe, writing the output file"
+                                 << " synchronously" << std::endl;
+            asyncSave = false;
+        }
+
+        // The transfers of an asynchronous save run alongside the MPI calls made by the
+        // main thread, including those of later saves, which use the same message tags.
+        // Give each asynchronous save its own duplicate of the obs space communicator so
+        // that these messages can never be matched against one another.
+        const eckit::mpi::Comm * saveComm = &obs_params_.comm();
+        if (asyncSave) {
+            save_comm_name_ = nextSaveCommName();
+            saveComm = &(obs_params_.comm().split(0, save_comm_name_));
+        }
+
+        // Set up the io pool here for both modes: its construction runs collective
+        // operations on the communicator.
+        save_pool_ = std::make_unique<IoPool>(obs_params_.top_level_.ioPool,
             obs_params_.top_level_.obsDataOut.value()->engine.value().engineParameters,
-            obs_params_.comm(), obs_params_.timeComm() ,
+            *saveComm, obs_params_.timeComm() ,
             obs_params_.windowStart(), obs_params_.windowEnd(), nlocs());
-        obsPool.save(obs_group_);
-        // Wait for all processes to finish the save call so that we know the file
-        // is complete and closed.
-        this->comm().barrier();
-        oops::Log::info() << obsname() << ": save database to " << obsPool << std::endl;
-        obsPool.finalize();
+
+        if (asyncSave) {
+            // Write from a copy of obs_group_ so that the obs space can be modified or
+            // destroyed while the output file is being written.
+            Engines::BackendCreationParameters backendParams;
+            Group snapshot =
+                Engines::constructBackend(Engines::BackendNames::ObsStore, backendParams);
+            copyGroup(obs_group_, snapshot);
+
+            IoPool * savePool = save_pool_.get();
+            std::shared_future<void> previousSave = lastAsyncSave();
+            save_future_ = std::async(std::launch::async,
+                [savePool, snapshot, previousSave]() mutable {
+                    if (previousSave.valid()) {
+                        previousSave.wait();
+                    }
+                    savePool->save(snapshot);
+                    // Release the copy now, the shared state can outlive this save
+                    snapshot = Group();
+                }).share();
+            lastAsyncSave() = save_future_;
+        } else {
+            save_pool_->save(obs_group_);
+            waitForSave();
+        }
     } else {
         oops::Log::info() << obsname() << " :  no output" << std::endl;
     }
 }
 
+// -----------------------------------------------------------------------------
+void ObsSpace::waitForSave() {
+    if (save_pool_ == nullptr) {
+        return;
+    }
+    std::unique_ptr<IoPool> savePool = std::move(save_pool_);
+    std::shared_future<void> saveFuture = std::move(save_future_);
+    if (saveFuture.valid()) {
+        saveFuture.get();
+    }
+    // Wait for all processes to finish the save call so that we know the file
+    // is complete and closed.
+    this->comm().barrier();
+    oops::Log::info() << obsname() << ": save database to " << *savePool << std::endl;
+    savePool->finalize();
+    if (!save_comm_name_.empty()) {
+        eckit::mpi::deleteComm(save_comm_name_.c_str());
+        save_comm_name_.clear();
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool ObsSpace::asyncSaveSupported() {
+    return mpiSupportsConcurrentThreads() && hdf5IsThreadSafe();
+}
+
 // -----------------------------------------------------------------------------
 std::size_t ObsSpace::nvars() const {
     // Nvars is the number of variables in the ObsValue group. By querying
@@ -301,6 +450,11 @@ bool ObsSpace::has(const std::string & group, const std::string & name, bool ski
            (!skipDerived && obs_group_.vars.exists(fullVarName("Derived" + group, nameToUse)));
 }
 
+// -----------------------------------------------------------------------------
+bool ObsSpace::isDeferred(const std::string & group, const std::string & name) const {
+    return (lazy_vars_.count(fullVarName(group, name)) > 0);
+}
+
 // -----------------------------------------------------------------------------
 ObsDtype ObsSpace::dtype(const std::string & group, const std::string & name,
                          bool skipDerived) const {
@@ -623,15 +777,9 @@ void ObsSpace::createObsGroupFromObsFrame(ObsFrameRead & obsFrame) {
 
 // -----------------------------------------------------------------------------
 template<typename VarType>
-bool ObsSpace::readObsSource(ObsFrameRead & obsFrame,
-                            const std::string & varName, std::vector<VarType> & varValues) {
-    Variable sourceVar = obsFrame.getObsGroup().vars.open(varName);
-
-    // Read the variable
-    bool gotVarData = obsFrame.readFrameVar(varName, varValues);
-
-    // Replace source fill values with corresponding missing marks
-    if ((gotVarData) && (sourceVar.hasFillValue())) {
+void ObsSpace::replaceFillValues(const Variable & sourceVar,
+                                 std::vector<VarType> & varValues) const {
+    if (sourceVar.hasFillValue()) {
         VarType sourceFillValue;
         detail::FillValueData_t sourceFvData = sourceVar.getFillValue();
         sourceFillValue = detail::getFillValue<VarType>(sourceFvData);
@@ -643,19 +791,12 @@ bool ObsSpace::readObsSource(ObsFrameRead & obsFrame,
             }
         }
     }
-    return gotVarData;
 }
 
 template<>
-bool ObsSpace::readObsSource(ObsFrameRead & obsFrame,
-                            const std::string & varName, std::vector<std::string> & varValues) {
-    Variable sourceVar = obsFrame.getObsGroup().vars.open(varName);
-
-    // Read the variable
-    bool gotVarData = obsFrame.readFrameVar(varName, varValues);
-
-    // Replace source fill values with corresponding missing marks
-    if ((gotVarData) && (sourceVar.hasFillValue())) {
+void ObsSpace::replaceFillValues(const Variable & sourceVar,
+                                 std::vector<std::string> & varValues) const {
+    if (sourceVar.hasFillValue()) {
         std::string sourceFillValue;
         detail::FillValueData_t sourceFvData = sourceVar.getFillValue();
         sourceFillValue = detail::getFillValue<std::string>(sourceFvData);
@@ -666,6 +807,21 @@ bool ObsSpace::readObsSource(ObsFrameRead & obsFrame,
             }
         }
     }
+}
+
+// -----------------------------------------------------------------------------
+template<typename VarType>
+bool ObsSpace::readObsSource(ObsFrameRead & obsFrame,
+                            const std::string & varName, std::vector<VarType> & varValues) {
+    Variable sourceVar = obsFrame.getObsGroup().vars.open(varName);
+
+    // Read the variable
+    bool gotVarData = obsFrame.readFrameVar(varName, varValues);
+
+    // Replace source fill values with corresponding missing marks
+    if (gotVarData) {
+        replaceFillValues<VarType>(sourceVar, varValues);
+    }
     return gotVarData;
 }
 
@@ -680,6 +836,19 @@ void ObsSpace::initFromObsSource(ObsFrameRead & obsFrame) {
     obsFrame.frameInit(obs_group_.atts);
     dims_attached_to_vars_ = obsFrame.varDimMap();
     createVariables(obsFrame.getObsGroup().vars, obs_group_.vars, dims_attached_to_vars_);
+
+    // Variables deferred by lazy loading are created above, but their data are only read
+    // from the obs source the first time they are accessed.
+    lazy_vars_ = obsFrame.lazyLoadVars();
+    if (!lazy_vars_.empty()) {
+        oops::Log::debug() << obsname() << ": deferring the read of " << lazy_vars_.size()
+                           << " variables until first access" << std::endl;
+    }
+    const std::size_t numThreads = numIngestThreads();
+    if (numThreads > 1) {
+        oops::Log::debug() << obsname() << ": storing frame variables with " << numThreads
+                           << " threads" << std::endl;
+    }
     for ( ; obsFrame.frameAvailable(); obsFrame.frameNext()) {
         Dimensions_t frameStart = obsFrame.frameStart();
 
@@ -692,6 +861,12 @@ void ObsSpace::initFromObsSource(ObsFrameRead & obsFrame) {
         known_fe_selections_.clear();
         known_be_selections_.clear();
 
+        if (numThreads > 1) {
+            ingestFrameVarsParallel(obsFrame, numThreads);
+            iframe++;
+            continue;
+        }
+
         // If the ioda input file only contained the string datetime representation
         // (variable MetaData/datetime), it has been converted to the epoch representation
         // (variable MetaData/dateTime) so the string datetime variable can be omitted
@@ -702,6 +877,9 @@ void ObsSpace::initFromObsSource(ObsFrameRead & obsFrame) {
             if ((varName == "MetaData/datetime") || (varName == "MetaData/time")) {
               continue;
             }
+            if (lazy_vars_.count(varName)) {
+              continue;
+            }
             Variable var = varNameObject.var;
             Dimensions_t beFrameStart;
             if (obsFrame.isVarDimByNlocs(varName)) {
@@ -747,6 +925,64 @@ void ObsSpace::initFromObsSource(ObsFrameRead & obsFrame) {
     recnums_ = obsFrame.recnums();
 }
 
+// -----------------------------------------------------------------------------
+std::size_t ObsSpace::numIngestThreads() const {
+    const int numThreads = obs_params_.top_level_.obsDataIn.value().ingestThreads;
+    return static_cast<std::size_t>(std::max(numThreads, 1));
+}
+
+// -----------------------------------------------------------------------------
+void ObsSpace::ingestFrameVarsParallel(ObsFrameRead & obsFrame, const std::size_t numThreads) {
+    // Read the variables of the frame one after the other, since the obs source and the
+    // frame may not allow concurrent access. For each variable that has data in this
+    // frame, queue up a task that replaces the fill values and writes the values into
+    // obs_group_. Everything the tasks need is opened and selected here so that the
+    // tasks only touch the memory buffer and the obs_group_ variable they own.
+    std::vector<std::function<void()>> tasks;
+    for (auto & varNameObject : obsFrame.varList()) {
+        std::string varName = varNameObject.name;
+        if ((varName == "MetaData/datetime") || (varName == "MetaData/time")) {
+          continue;
+        }
+        if (lazy_vars_.count(varName)) {
+          continue;
+        }
+        Dimensions_t beFrameStart;
+        if (obsFrame.isVarDimByNlocs(varName)) {
+            beFrameStart = obsFrame.adjNlocsFrameStart();
+        } else {
+            beFrameStart = obsFrame.frameStart();
+        }
+        Dimensions_t frameCount = obsFrame.frameCount(varName);
+
+        VarUtils::forAnySupportedVariableType(
+              varNameObject.var,
+              [&](auto typeDiscriminator) {
+                  typedef decltype(typeDiscriminator) T;
+                  auto varValues = std::make_shared<std::vector<T>>();
+                  if (obsFrame.readFrameVar(varName, *varValues)) {
+                      Variable sourceVar = obsFrame.getObsGroup().vars.open(varName);
+                      Variable destVar = obs_group_.vars.open(varName);
+                      VarUtils::Vec_Named_Variable dims =
+                          cacheStoreSelections(destVar, varName, beFrameStart, frameCount);
+                      // Copy the cached selections and drop any backend selection the
+                      // copies share with them, so that each task concretizes its own.
+                      Selection feSelect = known_fe_selections_[dims];
+                      Selection beSelect = known_be_selections_[dims];
+                      feSelect.invalidate();
+                      beSelect.invalidate();
+                      tasks.push_back([this, varValues, sourceVar, destVar,
+                                       feSelect, beSelect]() mutable {
+                          replaceFillValues<T>(sourceVar, *varValues);
+                          destVar.write<T>(*varValues, feSelect, beSelect);
+                      });
+                  }
+              },
+              VarUtils::ThrowIfVariableIsOfUnsupportedType(varName));
+    }
+    runTasks(tasks, numThreads);
+}
+
 // -----------------------------------------------------------------------------
 void ObsSpace::resizeNlocs(const Dimensions_t nlocsSize, const bool append) {
     Variable nlocsVar = obs_group_.vars.open(dim_info_.get_dim_name(ObsDimensionId::Nlocs));
@@ -778,6 +1014,9 @@ void ObsSpace::loadVar(const std::string & group, const std::string & name,
     if (skipDerived || !obs_group_.vars.exists(fullVarName(groupToUse, nameToUse)))
       groupToUse = group;
 
+    // Read the variable from the obs source if that was deferred.
+    loadLazyVar(fullVarName(groupToUse, nameToUse));
+
     // Try to open the variable.
     ioda::Variable var = obs_group_.vars.open(fullVarName(groupToUse, nameToUse));
 
@@ -814,6 +1053,67 @@ void ObsSpace::loadVar(const std::string & group, const std::string & name,
     }
 }
 
+// -----------------------------------------------------------------------------
+void ObsSpace::loadLazyVar(const std::string & varName) const {
+    auto ilazy = lazy_vars_.find(varName);
+    if (ilazy == lazy_vars_.end()) {
+        return;
+    }
+    const Variable sourceVar = ilazy->second;
+    lazy_vars_.erase(ilazy);
+    if (indx_.empty()) {
+        return;
+    }
+
+    // indx_ holds the obs source locations kept on this process in ascending order.
+    // Coalesce consecutive locations into (start, count) runs along the first dimension.
+    // Subsequent dimensions are selected in their entirety.
+    std::vector<Dimensions_t> runStarts;
+    std::vector<Dimensions_t> runCounts;
+    for (std::size_t i = 0; i < indx_.size(); ++i) {
+        Dimensions_t sourceIndex = indx_[i];
+        if (!runStarts.empty() && (runStarts.back() + runCounts.back() == sourceIndex)) {
+            runCounts.back()++;
+        } else {
+            runStarts.push_back(sourceIndex);
+            runCounts.push_back(1);
+        }
+    }
+    std::vector<Dimensions_t> sourceShape = sourceVar.getDimensions().dimsCur;
+    Selection sourceSelect;
+    sourceSelect.extent(sourceShape)
+        .select({ SelectionOperator::SET, 0, runStarts, runCounts });
+
+    const Dimensions_t numElements = std::accumulate(
+        sourceShape.begin() + 1, sourceShape.end(), static_cast<Dimensions_t>(indx_.size()),
+        std::multiplies<Dimensions_t>());
+    std::vector<Dimensions_t> memStarts(1, 0);
+    std::vector<Dimensions_t> memCounts(1, numElements);
+    Selection memSelect;
+    memSelect.extent(memCounts).select({ SelectionOperator::SET, memStarts, memCounts });
+
+    Variable destVar = obs_group_.vars.open(varName);
+    VarUtils::forAnySupportedVariableType(
+          sourceVar,
+          [&](auto typeDiscriminator) {
+              typedef decltype(typeDiscriminator) T;
+              std::vector<T> varValues(numElements);
+              sourceVar.read<T>(gsl::make_span(varValues.data(), varValues.size()),
+                                memSelect, sourceSelect);
+              replaceFillValues<T>(sourceVar, varValues);
+              destVar.write<T>(varValues);
+          },
+          VarUtils::ThrowIfVariableIsOfUnsupportedType(varName));
+}
+
+// -----------------------------------------------------------------------------
+void ObsSpace::loadAllLazyVars() const {
+    while (!lazy_vars_.empty()) {
+        const std::string varName = lazy_vars_.begin()->first;
+        loadLazyVar(varName);
+    }
+}
+
 // -----------------------------------------------------------------------------
 
 template<typename VarType>
@@ -848,6 +1148,14 @@ void ObsSpace::saveVar(const std::string & group, std::string name,
     }
     Variable var = openCreateVar<VarType>(fullName, dimListToUse);
 
+    // A variable deferred by lazy loading does not need to be read from the obs source
+    // when it is being overwritten in its entirety.
+    if (channels.empty()) {
+        lazy_vars_.erase(fullName);
+    } else {
+        loadLazyVar(fullName);
+    }
+
     if (channels.empty()) {
         var.write<VarType>(varValues);
     } else {
@@ -948,8 +1256,21 @@ std::size_t ObsSpace::createChannelSelections(const Variable & variable,
 template<typename VarType>
 void ObsSpace::storeVar(const std::string & varName, std::vector<VarType> & varValues,
                        const Dimensions_t frameStart, const Dimensions_t frameCount) {
-    // get the dimensions of the variable
     Variable var = obs_group_.vars.open(varName);
+    VarUtils::Vec_Named_Variable dims =
+        cacheStoreSelections(var, varName, frameStart, frameCount);
+    Selection & feSelect = known_fe_selections_[dims];
+    Selection & beSelect = known_be_selections_[dims];
+
+    var.write<VarType>(varValues, feSelect, beSelect);
+}
+
+// -----------------------------------------------------------------------------
+VarUtils::Vec_Named_Variable ObsSpace::cacheStoreSelections(const Variable & var,
+                                                            const std::string & varName,
+                                                            const Dimensions_t frameStart,
+                                                            const Dimensions_t frameCount) {
+    // get the dimensions of the variable
     std::vector<Dimensions_t> varDims = var.getDimensions().dimsCur;
 
     // check the caches for the selectors
@@ -981,10 +1302,7 @@ void ObsSpace::storeVar(const std::string & varName, std::vector<VarType> & varV
         known_be_selections_[dims] = Selection()
             .extent(varDims).select({ SelectionOperator::SET, beStarts, beCounts });
     }
-    Selection & feSelect = known_fe_selections_[dims];
-    Selection & beSelect = known_be_selections_[dims];
-
-    var.write<VarType>(varValues, feSelect, beSelect);
+    return dims;
 }
 
 // -----------------------------------------------------------------------------
@@ -17,6 +17,7 @@
 #define OBSSPACE_H_
 
 #include <functional>
+#include <future>
 #include <map>
 #include <memory>
 #include <numeric>
@@ -48,6 +49,7 @@ namespace eckit {
 }
 
 namespace ioda {
+    class IoPool;
     class ObsFrameRead;
     class ObsVector;
 
@@ -150,7 +152,7 @@ namespace ioda {
                 const util::DateTime & bgn, const util::DateTime & end,
                 const eckit::mpi::Comm & timeComm);
         ObsSpace(const ObsSpace &);
-        virtual ~ObsSpace() {}
+        virtual ~ObsSpace();
 
         /// @}
         /// @name Constructor-defined parameters
@@ -186,8 +188,29 @@ namespace ioda {
         ///          ObsSpace destructor (C++) is still writing to that file. These
         ///          actions can sometimes get out of sync since they are being triggered
         ///          from different sources during the clean up after a job completes.
+        ///
+        ///          When the "asynchronous save" option of obsdataout is enabled, the
+        ///          obs space data is copied and the output file is written on a background
+        ///          thread. The obs space can then be modified or destroyed before the file
+        ///          is complete; use waitForSave() to make sure the file has been written.
         void save();
 
+        /// \brief wait for the output file started by save() to be complete
+        /// \details This function blocks until the output file has been written and closed
+        ///          on all processes in the obs space communicator, so it needs to be called
+        ///          on all of them. It does nothing if there is no save in progress, and
+        ///          it passes on an exception thrown while writing the output file.
+        ///          The destructor only waits for the writes done on the calling process.
+        void waitForSave();
+
+        /// \brief return true if save() has started writing the output file on a background
+        /// thread and waitForSave() has not been called since
+        bool saveInProgress() const {return save_future_.valid();}
+
+        /// \brief return true if the MPI and HDF5 libraries allow the "asynchronous save"
+        /// option to write the output file on a background thread
+        static bool asyncSaveSupported();
+
         /// @}
         /// @name General querying functions
         /// @{
@@ -217,6 +240,11 @@ namespace ioda {
         /// "Variables" refers to the quantities that can be assimilated as opposed to meta data.
         std::size_t nvars() const;
 
+        /// \brief return the number of threads used to store the variables of a frame
+        /// \details Taken from the "ingest threads" obsdatain parameter, which defaults to
+        /// one thread.
+        std::size_t numIngestThreads() const;
+
         /// \brief return the standard dimension name for the given dimension id
         std::string get_dim_name(const ObsDimensionId dimId) const {
             return dim_info_.get_dim_name(dimId);
@@ -277,6 +305,10 @@ namespace ioda {
         bool has(const std::string & group, const std::string & name,
                  bool skipDerived = false) const;
 
+        /// \brief return true if the read of variable `name` in group `group` from the obs
+        /// source has been deferred by lazy loading and has not taken place yet
+        bool isDeferred(const std::string & group, const std::string & name) const;
+
         /// \brief return data type for group/variable
         /// \param group Group name containting the variable
         /// \param name Variable name
@@ -309,10 +341,10 @@ namespace ioda {
         /// @{
 
         /// \brief return the ObsGroup that stores the data
-        inline ObsGroup getObsGroup() { return obs_group_; }
+        inline ObsGroup getObsGroup() { loadAllLazyVars(); return obs_group_; }
 
         /// \brief return the ObsGroup that stores the data
-        inline const ObsGroup getObsGroup() const { return obs_group_; }
+        inline const ObsGroup getObsGroup() const { loadAllLazyVars(); return obs_group_; }
 
         /// @}
         /// @name IO functions
@@ -458,9 +490,24 @@ namespace ioda {
         /// \brief observation data store
         ObsGroup obs_group_;
 
+        /// \brief obs source variables that have not been read into obs_group_ yet
+        /// \details Only filled when lazy loading is enabled. An entry is removed once the
+        /// variable has been read from the obs source, or once it has been overwritten.
+        mutable std::map<std::string, Variable> lazy_vars_;
+
         /// \brief obs io parameters
         ObsSpaceParameters obs_params_;
 
+        /// \brief io pool of the save in progress (nullptr when there is none)
+        std::unique_ptr<IoPool> save_pool_;
+
+        /// \brief completion of the output file written on a background thread
+        std::shared_future<void> save_future_;
+
+        /// \brief name of the duplicate of the obs space communicator used by the save in
+        /// progress (empty when the save uses the obs space communicator itself)
+        std::string save_comm_name_;
+
         /// \brief name of obs space
         std::string obsname_;
 
@@ -552,6 +599,26 @@ namespace ioda {
         bool readObsSource(ObsFrameRead & obsFrame,
                            const std::string & varName, std::vector<VarType> & varValues);
 
+        /// \brief read the variables of the current frame and store them in obs_group_
+        /// \details The variables are read from the obs source one after the other. The
+        /// fill value replacement and the transfer into obs_group_, which is backed by
+        /// ObsStore, are then done for all the variables of the frame in parallel.
+        /// \param obsFrame obs frame object
+        /// \param numThreads number of threads, including the calling thread
+        void ingestFrameVarsParallel(ObsFrameRead & obsFrame, const std::size_t numThreads);
+
+        /// \brief make sure the selections for storing a frame of a variable in obs_group_
+        /// are in the known_fe_selections_ and known_be_selections_ caches
+        /// \param var obs_group_ variable
+        /// \param varName Name of obs_group_ variable
+        /// \param frameStart is the start of the ObsFrame
+        /// \param frameCount is the size of the ObsFrame
+        /// \return key of the selections in the caches
+        VarUtils::Vec_Named_Variable cacheStoreSelections(const Variable & var,
+                                                          const std::string & varName,
+                                                          const Dimensions_t frameStart,
+                                                          const Dimensions_t frameCount);
+
         /// \brief store a variable in the obs_group_ object
         /// \param obsIo obs source object
         /// \param varName Name of obs_group_ variable for obs_group_ object
@@ -564,11 +631,29 @@ namespace ioda {
 
         /// \brief get fill value for use in the obs_group_ object
         template<typename DataType>
-        DataType getFillValue() {
+        DataType getFillValue() const {
             DataType fillVal = util::missingValue(fillVal);
             return fillVal;
         }
 
+        /// \brief replace source fill values with the JEDI missing value
+        /// \details Infinite and NaN values are replaced as well. Nothing is done when
+        /// the source variable does not have a fill value.
+        /// \param sourceVar obs source variable
+        /// \param varValues values read from the obs source
+        template<typename VarType>
+        void replaceFillValues(const Variable & sourceVar,
+                               std::vector<VarType> & varValues) const;
+
+        /// \brief read a variable deferred by lazy loading from the obs source
+        /// \details Only the locations kept on this process (indx_) are read. Nothing is
+        /// done when the variable is not waiting to be loaded.
+        /// \param varName full variable name (group/name)
+        void loadLazyVar(const std::string & varName) const;
+
+        /// \brief read all variables deferred by lazy loading from the obs source
+        void loadAllLazyVars() const;
+
         /// \brief load a variable from the obs_group_ object
         /// \details This function will load data from the obs_group_ object into
         ///          the memory buffer (vector) varValues. The chanSelect parameter
@@ -168,25 +168,17 @@ double ObsVector::dot_product_with(const ObsVector & other) const {
 }
 // -----------------------------------------------------------------------------
 std::vector<double> ObsVector::multivar_dot_product_with(const ObsVector & other) const {
-  std::vector<double> result(nvars_, 0);
-  for (size_t jvar = 0; jvar < nvars_; ++jvar) {
-    // fill vectors for current variable (note: if elements in values_
-    // were distributed as all locs for var1; all locs for var2; etc, we
-    // wouldn't need copies here).
-    std::vector<double> x1(nlocs_);
-    std::vector<double> x2(nlocs_);
-    for (size_t jloc = 0; jloc < nlocs_; ++jloc) {
-      x1[jloc] = values_[jvar + (jloc * nvars_)];
-      x2[jloc] = other.values_[jvar + (jloc*nvars_)];
-    }
-    result[jvar] = dotProduct(*obsdb_.distribution(), 1, x1, x2);
-  }
-  return result;
+  return dotProductPerVariable(*obsdb_.distribution(), nvars_, values_, other.values_);
 }
 // -----------------------------------------------------------------------------
 double ObsVector::rms() const {
-  double zrms = dot_product_with(*this);
-  int nobs = this->nobs();
+  // Start both reductions before waiting for either of them.
+  const Distribution & dist = *obsdb_.distribution();
+  PendingReduction<double> dotProductResult = iDotProduct(dist, nvars_, values_, values_);
+  PendingReduction<std::size_t> nobsResult = iGlobalNumNonMissingObs(dist, nvars_, values_);
+
+  double zrms = dotProductResult.get();
+  int nobs = nobsResult.get();
   if (nobs > 0) zrms = sqrt(zrms / static_cast<double>(nobs));
 
   return zrms;
@@ -303,17 +295,25 @@ double & ObsVector::toFortran() {
 void ObsVector::print(std::ostream & os) const {
   double zmin = std::numeric_limits<double>::max();
   double zmax = std::numeric_limits<double>::lowest();
-  double zrms = rms();
-  int nobs = this->nobs();
+
+  // Start all the reductions needed for the statistics, then wait for them together.
+  const Distribution & dist = *obsdb_.distribution();
+  PendingReduction<double> dotProductResult = iDotProduct(dist, nvars_, values_, values_);
+  PendingReduction<std::size_t> nobsResult = iGlobalNumNonMissingObs(dist, nvars_, values_);
   for (size_t jj = 0; jj < values_.size() ; ++jj) {
     if (values_[jj] != missing_) {
       if (values_[jj] < zmin) zmin = values_[jj];
       if (values_[jj] > zmax) zmax = values_[jj];
     }
   }
+  PendingReduction<double> minResult = dist.iMin(zmin);
+  PendingReduction<double> maxResult = dist.iMax(zmax);
 
-  obsdb_.distribution()->min(zmin);
-  obsdb_.distribution()->max(zmax);
+  int nobs = nobsResult.get();
+  double zrms = dotProductResult.get();
+  if (nobs > 0) zrms = sqrt(zrms / static_cast<double>(nobs));
+  zmin = minResult.get();
+  zmax = maxResult.get();
 
   if (nobs > 0) {
     os << obsdb_.obsname() << " nobs= " << nobs << " Min="
@@ -6,7 +6,7 @@
  */
 
 #include <iostream>
-#include <unordered_set>
+#include <vector>
 
 #include <boost/make_unique.hpp>
 
@@ -38,9 +38,17 @@ class AtlasDistribution::RecordAssigner {
   /// It is assumed that records will be assigned in consecutive order.
   void assignRecord(std::size_t recNum, const eckit::geometry::Point2 & point);
 
+  /// Calls assignRecord() for each element of `recNums` and `points` in turn.
+  void assignRecords(const std::vector<std::size_t> & recNums,
+                     const std::vector<eckit::geometry::Point2> & points);
+
   /// Returns true if record `recNum` has been assigned to the calling process, false otherwise.
   bool isMyRecord(std::size_t recNum) const;
 
+  /// Sets each element of `isMine` to the result of isMyRecord() for the corresponding element
+  /// of `recNums`.
+  void flagMyRecords(const std::vector<std::size_t> & recNums, std::vector<bool> & isMine) const;
+
  private:
   bool isInMyDomain(const eckit::geometry::Point2 & point) const;
 
@@ -48,7 +56,9 @@ class AtlasDistribution::RecordAssigner {
   atlas::Mesh mesh_;
   std::unique_ptr<atlas::util::PolygonLocator> locator_;
 
-  std::unordered_set<std::size_t> myRecords_;
+  // Records are assigned in consecutive order, so element `r` indicates whether record `r`
+  // has been assigned to the calling process.
+  std::vector<bool> myRecords_;
   std::size_t nextRecordToAssign_ = 0;
 };
 
@@ -80,8 +90,7 @@ void AtlasDistribution::RecordAssigner::assignRecord(std::size_t recNum,
     const bool myRecord = isInMyDomain(point);
     oops::Log::debug() << "RecordAssigner::assignRecord(): is " << recNum << " my record? "
                        << myRecord << std::endl;
-    if (myRecord)
-      myRecords_.insert(recNum);
+    myRecords_.push_back(myRecord);
     ++nextRecordToAssign_;
   } else {
     // We assume records will be assigned in consecutive order
@@ -89,8 +98,22 @@ void AtlasDistribution::RecordAssigner::assignRecord(std::size_t recNum,
   }
 }
 
+void AtlasDistribution::RecordAssigner::assignRecords(
+    const std::vector<std::size_t> & recNums,
+    const std::vector<eckit::geometry::Point2> & points) {
+  for (std::size_t i = 0; i < recNums.size(); ++i)
+    assignRecord(recNums[i], points[i]);
+}
+
 bool AtlasDistribution::RecordAssigner::isMyRecord(std::size_t recNum) const {
-  return myRecords_.find(recNum) != myRecords_.end();
+  return recNum < myRecords_.size() && myRecords_[recNum];
+}
+
+void AtlasDistribution::RecordAssigner::flagMyRecords(const std::vector<std::size_t> & recNums,
+                                                      std::vector<bool> & isMine) const {
+  isMine.resize(recNums.size());
+  for (std::size_t i = 0; i < recNums.size(); ++i)
+    isMine[i] = isMyRecord(recNums[i]);
 }
 
 bool AtlasDistribution::RecordAssigner::isInMyDomain(const eckit::geometry::Point2 & point) const {
@@ -123,10 +146,23 @@ void AtlasDistribution::assignRecord(const std::size_t recNum,
   NonoverlappingDistribution::assignRecord(recNum, locNum, point);
 }
 
+void AtlasDistribution::assignRecords(const std::vector<std::size_t> & recNums,
+                                     const std::vector<std::size_t> & locNums,
+                                     const std::vector<eckit::geometry::Point2> & points,
+                                     std::vector<bool> & isMine) {
+  recordAssigner_->assignRecords(recNums, points);
+  NonoverlappingDistribution::assignRecords(recNums, locNums, points, isMine);
+}
+
 bool AtlasDistribution::isMyRecord(std::size_t RecNum) const {
   return recordAssigner_->isMyRecord(RecNum);
 }
 
+void AtlasDistribution::flagMyRecords(const std::vector<std::size_t> & recNums,
+                                      std::vector<bool> & isMine) const {
+  recordAssigner_->flagMyRecords(recNums, isMine);
+}
+
 std::string AtlasDistribution::name() const {
   return "Atlas";
 }
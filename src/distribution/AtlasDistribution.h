@@ -9,6 +9,7 @@
 #define DISTRIBUTION_ATLASDISTRIBUTION_H_
 
 #include <memory>
+#include <vector>
 
 #include "ioda/distribution/DistributionParametersBase.h"
 #include "ioda/distribution/NonoverlappingDistribution.h"
@@ -43,8 +44,14 @@ class AtlasDistribution: public NonoverlappingDistribution {
 
     void assignRecord(const std::size_t recNum, const std::size_t locNum,
                       const eckit::geometry::Point2 & point) override;
+    void assignRecords(const std::vector<std::size_t> & recNums,
+                       const std::vector<std::size_t> & locNums,
+                       const std::vector<eckit::geometry::Point2> & points,
+                       std::vector<bool> & isMine) override;
 
     bool isMyRecord(std::size_t recNum) const override;
+    void flagMyRecords(const std::vector<std::size_t> & recNums,
+                       std::vector<bool> & isMine) const override;
 
     std::string name() const override;
 
@@ -26,4 +26,58 @@ Distribution::~Distribution() {
   oops::Log::trace() << "Distribtion destructed" << std::endl;
 }
 
+// -----------------------------------------------------------------------------
+
+void Distribution::assignRecords(const std::vector<std::size_t> & RecNums,
+                                 const std::vector<std::size_t> & LocNums,
+                                 const std::vector<eckit::geometry::Point2> & points,
+                                 std::vector<bool> & isMine) {
+  isMine.resize(RecNums.size());
+  for (std::size_t i = 0; i < RecNums.size(); ++i) {
+    assignRecord(RecNums[i], LocNums[i], points[i]);
+    isMine[i] = isMyRecord(RecNums[i]);
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+void Distribution::flagMyRecords(const std::vector<std::size_t> & RecNums,
+                                 std::vector<bool> & isMine) const {
+  isMine.resize(RecNums.size());
+  for (std::size_t i = 0; i < RecNums.size(); ++i)
+    isMine[i] = isMyRecord(RecNums[i]);
+}
+
+// -----------------------------------------------------------------------------
+
+const std::vector<std::size_t> & Distribution::patchObsIndices(const std::size_t numLocs) const {
+  if (!patchObsIndicesValid_ || patchObsIndicesNumLocs_ != numLocs) {
+    std::vector<bool> isPatchObs(numLocs);
+    patchObs(isPatchObs);
+    patchObsIndices_.clear();
+    for (std::size_t loc = 0; loc < numLocs; ++loc)
+      if (isPatchObs[loc])
+        patchObsIndices_.push_back(loc);
+    patchObsIndicesNumLocs_ = numLocs;
+    patchObsIndicesValid_ = true;
+  }
+  return patchObsIndices_;
+}
+
+// -----------------------------------------------------------------------------
+
+double Distribution::allReduceSum(double localSum) const {
+  comm_.allReduceInPlace(localSum, eckit::mpi::sum());
+  return localSum;
+}
+
+std::size_t Distribution::allReduceSum(std::size_t localSum) const {
+  comm_.allReduceInPlace(localSum, eckit::mpi::sum());
+  return localSum;
+}
+
+void Distribution::allReduceSum(std::vector<double> & localSums) const {
+  comm_.allReduceInPlace(localSums.begin(), localSums.end(), eckit::mpi::sum());
+}
+
 }  // namespace ioda
@@ -9,6 +9,7 @@
 #define DISTRIBUTION_DISTRIBUTION_H_
 
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "eckit/config/Configuration.h"
@@ -18,6 +19,8 @@
 #include "oops/util/missingValues.h"
 #include "oops/util/TypeTraits.h"
 
+#include "ioda/distribution/PendingReduction.h"
+
 namespace util {
 class DateTime;
 }
@@ -89,6 +92,34 @@ class Distribution {
      */
     virtual bool isMyRecord(std::size_t RecNum) const = 0;
 
+    /*!
+     * \brief Assigns the records containing a batch of locations and flags the locations
+     * belonging to records assigned to the calling PE.
+     *
+     * Equivalent to calling assignRecord() and then isMyRecord() for each location in turn.
+     * Subclasses can override it to avoid two virtual calls and lookups per location.
+     *
+     * \param RecNums Records containing the locations.
+     * \param LocNums (Global) location indices.
+     * \param points Longitudes and latitudes of the locations.
+     * \param isMine Resized to the number of locations. On output, each element is true if the
+     * corresponding location belongs to a record assigned to the calling PE, false otherwise.
+     */
+    virtual void assignRecords(const std::vector<std::size_t> & RecNums,
+                               const std::vector<std::size_t> & LocNums,
+                               const std::vector<eckit::geometry::Point2> & points,
+                               std::vector<bool> & isMine);
+
+    /*!
+     * \brief Sets each element of \p isMine to the result of isMyRecord() for the corresponding
+     * element of \p RecNums.
+     *
+     * \param RecNums Record numbers.
+     * \param isMine Resized to the number of records.
+     */
+    virtual void flagMyRecords(const std::vector<std::size_t> & RecNums,
+                               std::vector<bool> & isMine) const;
+
     /*!
      * \brief If necessary, identifies locations of "patch obs", i.e. locations belonging to
      * records owned by this PE.
@@ -107,6 +138,40 @@ class Distribution {
      */
     virtual void patchObs(std::vector<bool> & isPatchObs) const = 0;
 
+    /*!
+     * \brief Returns the indices of the "patch obs" held on this PE, in increasing order.
+     *
+     * The indices are derived from patchObs() on the first call after the number of locations
+     * changes and cached, so that reductions over patch obs can skip the other locations
+     * without querying the mask location by location.
+     *
+     * \param numLocs Number of locations held on this PE.
+     */
+    const std::vector<std::size_t> & patchObsIndices(std::size_t numLocs) const;
+
+    /*!
+     * \brief Returns the sum over all PEs of \p localSum, a partial sum of a location-dependent
+     * quantity computed over the patch obs held on the calling PE.
+     */
+    double allReduceSum(double localSum) const;
+    std::size_t allReduceSum(std::size_t localSum) const;
+
+    /*!
+     * \brief Replaces each element of \p localSums, a partial sum computed over the patch obs
+     * held on the calling PE, with its sum over all PEs. All elements are reduced together in a
+     * single collective operation.
+     */
+    void allReduceSum(std::vector<double> & localSums) const;
+
+    /*!
+     * \brief Non-blocking version of allReduceSum(). Returns a handle whose get() method waits
+     * for the global sum(s).
+     */
+    template <typename T>
+    PendingReduction<T> iAllReduceSum(T localSum) const {
+        return PendingReduction<T>(std::move(localSum), eckit::mpi::Operation::SUM, comm_);
+    }
+
     /*!
      * \brief Calculates the global minimum (over all locations on all PEs) of a
      * location-dependent quantity.
@@ -161,6 +226,27 @@ class Distribution {
     virtual void max(std::vector<float> & x) const = 0;
     virtual void max(std::vector<double> & x) const = 0;
 
+    /*!
+     * \brief Non-blocking versions of min() and max().
+     *
+     * Start calculating the global minimum or maximum of \p x, the local minimum or maximum
+     * of one or more location-dependent quantities, and return a handle whose get() method
+     * waits for the result. Reductions started on all PEs in the same order may be in flight
+     * together and overlap with local computations.
+     *
+     * \tparam T
+     *   Must be either `int`, `size_t`, `float`, `double` or a vector of one of these types.
+     */
+    template <typename T>
+    PendingReduction<T> iMin(T x) const {
+        return startReduction(std::move(x), eckit::mpi::Operation::MIN);
+    }
+
+    template <typename T>
+    PendingReduction<T> iMax(T x) const {
+        return startReduction(std::move(x), eckit::mpi::Operation::MAX);
+    }
+
     /*!
      * \brief Create an object that can be used to calculate the sum of a location-dependent
      * quantity over locations held on all PEs, each taken into account only once even if it's
@@ -266,6 +352,22 @@ class Distribution {
  protected:
      /*! \brief Local MPI communicator */
      const eckit::mpi::Comm & comm_;
+
+ private:
+     /*! \brief Start a non-blocking min or max reduction (see iMin() and iMax()) */
+     template <typename T>
+     PendingReduction<T> startReduction(T x, eckit::mpi::Operation::Code op) const {
+         // Each PE holding all locations already has the global result.
+         if (isIdentity())
+             return PendingReduction<T>(std::move(x));
+         return PendingReduction<T>(std::move(x), op, comm_);
+     }
+
+     /*! \brief Cached result of patchObsIndices() */
+     mutable std::vector<std::size_t> patchObsIndices_;
+     /*! \brief Number of locations for which patchObsIndices_ was computed */
+     mutable std::size_t patchObsIndicesNumLocs_ = 0;
+     mutable bool patchObsIndicesValid_ = false;
 };
 
 }  // namespace ioda
@@ -0,0 +1,51 @@
+/*
+ * (C) Copyright 2022 UCAR
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ */
+
+#include "ioda/distribution/DistributionCache.h"
+
+#include "ioda/distribution/Distribution.h"
+
+namespace ioda {
+
+// -----------------------------------------------------------------------------
+std::shared_ptr<Distribution> DistributionCache::find(const std::string & key) {
+  auto it = entries().find(key);
+  if (it == entries().end())
+    return nullptr;
+  std::shared_ptr<Distribution> dist = it->second.lock();
+  if (dist == nullptr)
+    entries().erase(it);
+  return dist;
+}
+
+// -----------------------------------------------------------------------------
+void DistributionCache::insert(const std::string & key,
+                               const std::shared_ptr<Distribution> & dist) {
+  // Drop the entries of distributions that have since been released
+  for (auto it = entries().begin(); it != entries().end(); ) {
+    if (it->second.expired())
+      it = entries().erase(it);
+    else
+      ++it;
+  }
+  entries()[key] = dist;
+}
+
+// -----------------------------------------------------------------------------
+void DistributionCache::clear() {
+  entries().clear();
+}
+
+// -----------------------------------------------------------------------------
+std::map<std::string, std::weak_ptr<Distribution>> & DistributionCache::entries() {
+  static std::map<std::string, std::weak_ptr<Distribution>> entries_;
+  return entries_;
+}
+
+// -----------------------------------------------------------------------------
+
+}  // namespace ioda
@@ -0,0 +1,49 @@
+/*
+ * (C) Copyright 2022 UCAR
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ */
+
+#ifndef DISTRIBUTION_DISTRIBUTIONCACHE_H_
+#define DISTRIBUTION_DISTRIBUTIONCACHE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+
+namespace ioda {
+
+class Distribution;
+
+/// \brief Registry of distributions whose records have all been assigned, so that they can be
+/// shared by ObsSpaces reading the same locations.
+///
+/// The assignment of records to PEs (and the patch obs computed from it) only depends on the
+/// sequence of locations and records passed to the distribution. ObsSpaces reading the same
+/// obs source with the same obs grouping, timing window, communicator and distribution
+/// parameters therefore end up with identical distributions. The caller builds a key covering
+/// all of these and looks it up before assigning any record; on a hit, the cached distribution
+/// is used as is and only queried with isMyRecord() or flagMyRecords().
+///
+/// Entries are held through weak pointers: a cached distribution is released as soon as the
+/// last ObsSpace using it is destroyed.
+class DistributionCache {
+ public:
+    /// \brief Return the distribution stored under `key`, or a null pointer if there is none.
+    static std::shared_ptr<Distribution> find(const std::string & key);
+
+    /// \brief Store `dist` under `key`. computePatchLocs() must already have been called
+    /// on `dist`.
+    static void insert(const std::string & key, const std::shared_ptr<Distribution> & dist);
+
+    /// \brief Remove all entries.
+    static void clear();
+
+ private:
+    static std::map<std::string, std::weak_ptr<Distribution>> & entries();
+};
+
+}  // namespace ioda
+
+#endif  // DISTRIBUTION_DISTRIBUTIONCACHE_H_
@@ -24,6 +24,13 @@ class DistributionParametersBase : public oops::Parameters {
  public:
   oops::Parameter<std::string> name{"name", "type of the observation MPI distribution",
                                     "RoundRobin", this};
+
+  /// If true, ObsSpaces reading the same obs source with the same obs grouping, timing window,
+  /// communicator and distribution parameters share the assignment of records to PEs
+  /// computed by the first of them instead of recomputing it.
+  oops::Parameter<bool> cacheOwnership{"cache ownership",
+                                       "reuse the record ownership of an earlier ObsSpace "
+                                       "reading the same locations", false, this};
 };
 
 // -----------------------------------------------------------------------------
@@ -5,6 +5,8 @@
  * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
  */
 
+#include <utility>
+
 #include "ioda/distribution/Accumulator.h"
 #include "ioda/distribution/Distribution.h"
 #include "ioda/distribution/DistributionParametersBase.h"
@@ -20,45 +22,111 @@ namespace ioda {
 
 namespace {
 
+/// \brief Calls `addLoc(loc)` for each location held on the calling PE that should contribute
+/// to the local partial sums, i.e. each patch obs, visited through the index list cached by the
+/// distribution.
+///
+/// \return False if the local partial sums are already global sums (because every PE holds all
+/// locations), true if they still need to be reduced over all PEs.
+template <typename AddLoc>
+bool forEachLocToSum(const Distribution &dist, std::size_t numLocations, const AddLoc &addLoc) {
+  if (dist.isIdentity()) {
+    for (std::size_t loc = 0; loc < numLocations; ++loc)
+      addLoc(loc);
+    return false;
+  }
+
+  const std::vector<std::size_t> &patchLocs = dist.patchObsIndices(numLocations);
+  if (patchLocs.size() == numLocations) {
+    for (std::size_t loc = 0; loc < numLocations; ++loc)
+      addLoc(loc);
+  } else {
+    for (const std::size_t loc : patchLocs)
+      addLoc(loc);
+  }
+  return true;
+}
+
+/// \brief Starts calculating the sum over all locations held on all PEs of `locTerm(loc)`, each
+/// location taken into account only once even if it's held on multiple PEs.
+template <typename R, typename LocTerm>
+PendingReduction<R> iSumOverPatchObs(const Distribution &dist, std::size_t numLocations,
+                                     const LocTerm &locTerm) {
+  R localSum = 0;
+  const bool reduce = forEachLocToSum(dist, numLocations,
+                                      [&](std::size_t loc) { localSum += locTerm(loc); });
+  return reduce ? dist.iAllReduceSum(localSum) : PendingReduction<R>(localSum);
+}
+
 template <typename T>
-std::size_t globalNumNonMissingObsImpl(const Distribution &dist,
-                                       std::size_t numVariables, const std::vector<T> &v) {
+PendingReduction<std::size_t> iGlobalNumNonMissingObsImpl(const Distribution &dist,
+                                                          std::size_t numVariables,
+                                                          const std::vector<T> &v) {
   const T missingValue = util::missingValue(missingValue);
   const std::size_t numLocations = v.size() / numVariables;
+  const T *values = v.data();
 
-  // Local reduction
-  std::unique_ptr<Accumulator<std::size_t>> accumulator = dist.createAccumulator<std::size_t>();
-  for (size_t loc = 0, element = 0; loc < numLocations; ++loc) {
+  return iSumOverPatchObs<std::size_t>(dist, numLocations, [&](std::size_t loc) {
+    const T *locValues = values + loc * numVariables;
     std::size_t term = 0;
-    for (size_t var = 0; var < numVariables; ++var, ++element)
-      if (v[element] != missingValue)
-        ++term;
-    accumulator->addTerm(loc, term);
-  }
-  // Global reduction
-  return accumulator->computeResult();
+    for (size_t var = 0; var < numVariables; ++var)
+      term += (locValues[var] != missingValue);
+    return term;
+  });
 }
 
 template <typename T>
-double dotProductImpl(const Distribution &dist,
-                      std::size_t numVariables,
-                      const std::vector<T> &v1,
-                      const std::vector<T> &v2) {
+PendingReduction<double> iDotProductImpl(const Distribution &dist,
+                                         std::size_t numVariables,
+                                         const std::vector<T> &v1,
+                                         const std::vector<T> &v2) {
   ASSERT(v1.size() == v2.size());
   const T missingValue = util::missingValue(missingValue);
   const std::size_t numLocations = v1.size() / numVariables;
+  const T *values1 = v1.data();
+  const T *values2 = v2.data();
 
-  // Local reduction
-  std::unique_ptr<Accumulator<double>> accumulator = dist.createAccumulator<double>();
-  for (size_t loc = 0, element = 0; loc < numLocations; ++loc) {
+  return iSumOverPatchObs<double>(dist, numLocations, [&](std::size_t loc) {
+    const T *locValues1 = values1 + loc * numVariables;
+    const T *locValues2 = values2 + loc * numVariables;
     double term = 0;
-    for (size_t var = 0; var < numVariables; ++var, ++element)
-      if (v1[element] != missingValue && v2[element] != missingValue)
-        term += v1[element] * v2[element];
-    accumulator->addTerm(loc, term);
-  }
-  // Global reduction
-  return accumulator->computeResult();
+    // Written as a select rather than an if statement so that it can be vectorized.
+    for (size_t var = 0; var < numVariables; ++var) {
+      const bool valid = (locValues1[var] != missingValue) & (locValues2[var] != missingValue);
+      term += valid ? locValues1[var] * locValues2[var] : T(0);
+    }
+    return term;
+  });
+}
+
+template <typename T>
+PendingReduction<std::vector<double>> iDotProductPerVariableImpl(const Distribution &dist,
+                                                                 std::size_t numVariables,
+                                                                 const std::vector<T> &v1,
+                                                                 const std::vector<T> &v2) {
+  ASSERT(v1.size() == v2.size());
+  if (numVariables == 0)
+    return PendingReduction<std::vector<double>>(std::vector<double>());
+  const T missingValue = util::missingValue(missingValue);
+  const std::size_t numLocations = v1.size() / numVariables;
+  const T *values1 = v1.data();
+  const T *values2 = v2.data();
+
+  // One pass over the interleaved data accumulates the partial sums of all variables...
+  std::vector<double> result(numVariables, 0.0);
+  double *sums = result.data();
+  const bool reduce = forEachLocToSum(dist, numLocations, [&](std::size_t loc) {
+    const T *locValues1 = values1 + loc * numVariables;
+    const T *locValues2 = values2 + loc * numVariables;
+    for (size_t var = 0; var < numVariables; ++var) {
+      const bool valid = (locValues1[var] != missingValue) & (locValues2[var] != missingValue);
+      sums[var] += valid ? locValues1[var] * locValues2[var] : T(0);
+    }
+  });
+  // ... and a single collective reduces them all.
+  if (reduce)
+    return dist.iAllReduceSum(std::move(result));
+  return PendingReduction<std::vector<double>>(std::move(result));
 }
 
 }  // namespace
@@ -68,73 +136,192 @@ double dotProduct(const Distribution &dist,
                   std::size_t numVariables,
                   const std::vector<double> &v1,
                   const std::vector<double> &v2) {
-  return dotProductImpl(dist, numVariables, v1, v2);
+  return iDotProductImpl(dist, numVariables, v1, v2).get();
 }
 
 double dotProduct(const Distribution &dist,
                   std::size_t numVariables,
                   const std::vector<float> &v1,
                   const std::vector<float> &v2) {
-  return dotProductImpl(dist, numVariables, v1, v2);
+  return iDotProductImpl(dist, numVariables, v1, v2).get();
 }
 
 double dotProduct(const Distribution &dist,
                   std::size_t numVariables,
                   const std::vector<int> &v1,
                   const std::vector<int> &v2) {
-  return dotProductImpl(dist, numVariables, v1, v2);
+  return iDotProductImpl(dist, numVariables, v1, v2).get();
 }
 
 double dotProduct(const Distribution &dist,
                   std::size_t numVariables,
                   const std::vector<int64_t> &v1,
                   const std::vector<int64_t> &v2) {
-  return dotProductImpl(dist, numVariables, v1, v2);
+  return iDotProductImpl(dist, numVariables, v1, v2).get();
+}
+
+// -----------------------------------------------------------------------------
+PendingReduction<double> iDotProduct(const Distribution &dist,
+                                     std::size_t numVariables,
+                                     const std::vector<double> &v1,
+                                     const std::vector<double> &v2) {
+  return iDotProductImpl(dist, numVariables, v1, v2);
+}
+
+PendingReduction<double> iDotProduct(const Distribution &dist,
+                                     std::size_t numVariables,
+                                     const std::vector<float> &v1,
+                                     const std::vector<float> &v2) {
+  return iDotProductImpl(dist, numVariables, v1, v2);
+}
+
+PendingReduction<double> iDotProduct(const Distribution &dist,
+                                     std::size_t numVariables,
+                                     const std::vector<int> &v1,
+                                     const std::vector<int> &v2) {
+  return iDotProductImpl(dist, numVariables, v1, v2);
+}
+
+PendingReduction<double> iDotProduct(const Distribution &dist,
+                                     std::size_t numVariables,
+                                     const std::vector<int64_t> &v1,
+                                     const std::vector<int64_t> &v2) {
+  return iDotProductImpl(dist, numVariables, v1, v2);
+}
+
+// -----------------------------------------------------------------------------
+std::vector<double> dotProductPerVariable(const Distribution &dist,
+                                          std::size_t numVariables,
+                                          const std::vector<double> &v1,
+                                          const std::vector<double> &v2) {
+  return iDotProductPerVariableImpl(dist, numVariables, v1, v2).get();
+}
+
+std::vector<double> dotProductPerVariable(const Distribution &dist,
+                                          std::size_t numVariables,
+                                          const std::vector<float> &v1,
+                                          const std::vector<float> &v2) {
+  return iDotProductPerVariableImpl(dist, numVariables, v1, v2).get();
+}
+
+std::vector<double> dotProductPerVariable(const Distribution &dist,
+                                          std::size_t numVariables,
+                                          const std::vector<int> &v1,
+                                          const std::vector<int> &v2) {
+  return iDotProductPerVariableImpl(dist, numVariables, v1, v2).get();
+}
+
+std::vector<double> dotProductPerVariable(const Distribution &dist,
+                                          std::size_t numVariables,
+                                          const std::vector<int64_t> &v1,
+                                          const std::vector<int64_t> &v2) {
+  return iDotProductPerVariableImpl(dist, numVariables, v1, v2).get();
+}
+
+// -----------------------------------------------------------------------------
+PendingReduction<std::vector<double>> iDotProductPerVariable(const Distribution &dist,
+                                                             std::size_t numVariables,
+                                                             const std::vector<double> &v1,
+                                                             const std::vector<double> &v2) {
+  return iDotProductPerVariableImpl(dist, numVariables, v1, v2);
+}
+
+PendingReduction<std::vector<double>> iDotProductPerVariable(const Distribution &dist,
+                                                             std::size_t numVariables,
+                                                             const std::vector<float> &v1,
+                                                             const std::vector<float> &v2) {
+  return iDotProductPerVariableImpl(dist, numVariables, v1, v2);
+}
+
+PendingReduction<std::vector<double>> iDotProductPerVariable(const Distribution &dist,
+                                                             std::size_t numVariables,
+                                                             const std::vector<int> &v1,
+                                                             const std::vector<int> &v2) {
+  return iDotProductPerVariableImpl(dist, numVariables, v1, v2);
+}
+
+PendingReduction<std::vector<double>> iDotProductPerVariable(const Distribution &dist,
+                                                             std::size_t numVariables,
+                                                             const std::vector<int64_t> &v1,
+                                                             const std::vector<int64_t> &v2) {
+  return iDotProductPerVariableImpl(dist, numVariables, v1, v2);
 }
 
 // -----------------------------------------------------------------------------
 std::size_t globalNumNonMissingObs(const Distribution &dist,
                                    std::size_t numVariables,
                                    const std::vector<double> &v) {
-  return globalNumNonMissingObsImpl(dist, numVariables, v);
+  return iGlobalNumNonMissingObsImpl(dist, numVariables, v).get();
 }
 
 std::size_t globalNumNonMissingObs(const Distribution &dist,
                                    std::size_t numVariables,
                                    const std::vector<float> &v) {
-  return globalNumNonMissingObsImpl(dist, numVariables, v);
+  return iGlobalNumNonMissingObsImpl(dist, numVariables, v).get();
 }
 
 std::size_t globalNumNonMissingObs(const Distribution &dist,
                                    std::size_t numVariables,
                                    const std::vector<int> &v) {
-  return globalNumNonMissingObsImpl(dist, numVariables, v);
+  return iGlobalNumNonMissingObsImpl(dist, numVariables, v).get();
 }
 
 std::size_t globalNumNonMissingObs(const Distribution &dist,
                                    std::size_t numVariables,
                                    const std::vector<std::string> &v) {
-  return globalNumNonMissingObsImpl(dist, numVariables, v);
+  return iGlobalNumNonMissingObsImpl(dist, numVariables, v).get();
 }
 
 std::size_t globalNumNonMissingObs(const Distribution &dist,
                                    std::size_t numVariables,
                                    const std::vector<util::DateTime> &v) {
-  return globalNumNonMissingObsImpl(dist, numVariables, v);
+  return iGlobalNumNonMissingObsImpl(dist, numVariables, v).get();
 }
 
 std::size_t globalNumNonMissingObs(const Distribution &dist,
                                    std::size_t numVariables,
                                    const std::vector<bool> &v) {
-  const std::size_t numLocations = v.size() / numVariables;
+  return iGlobalNumNonMissingObs(dist, numVariables, v).get();
+}
+
+// -----------------------------------------------------------------------------
+PendingReduction<std::size_t> iGlobalNumNonMissingObs(const Distribution &dist,
+                                                      std::size_t numVariables,
+                                                      const std::vector<double> &v) {
+  return iGlobalNumNonMissingObsImpl(dist, numVariables, v);
+}
+
+PendingReduction<std::size_t> iGlobalNumNonMissingObs(const Distribution &dist,
+                                                      std::size_t numVariables,
+                                                      const std::vector<float> &v) {
+  return iGlobalNumNonMissingObsImpl(dist, numVariables, v);
+}
 
-  // Local reduction
-  std::unique_ptr<Accumulator<std::size_t>> accumulator = dist.createAccumulator<std::size_t>();
-  for (size_t loc = 0; loc < numLocations; ++loc)
-    accumulator->addTerm(loc, numVariables);
+PendingReduction<std::size_t> iGlobalNumNonMissingObs(const Distribution &dist,
+                                                      std::size_t numVariables,
+                                                      const std::vector<int> &v) {
+  return iGlobalNumNonMissingObsImpl(dist, numVariables, v);
+}
+
+PendingReduction<std::size_t> iGlobalNumNonMissingObs(const Distribution &dist,
+                                                      std::size_t numVariables,
+                                                      const std::vector<std::string> &v) {
+  return iGlobalNumNonMissingObsImpl(dist, numVariables, v);
+}
+
+PendingReduction<std::size_t> iGlobalNumNonMissingObs(const Distribution &dist,
+                                                      std::size_t numVariables,
+                                                      const std::vector<util::DateTime> &v) {
+  return iGlobalNumNonMissingObsImpl(dist, numVariables, v);
+}
+
+PendingReduction<std::size_t> iGlobalNumNonMissingObs(const Distribution &dist,
+                                                      std::size_t numVariables,
+                                                      const std::vector<bool> &v) {
+  const std::size_t numLocations = v.size() / numVariables;
 
-  // Global reduction
-  return accumulator->computeResult();
+  return iSumOverPatchObs<std::size_t>(dist, numLocations,
+                                       [numVariables](std::size_t) { return numVariables; });
 }
 
 // -----------------------------------------------------------------------------
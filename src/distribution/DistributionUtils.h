@@ -12,6 +12,8 @@
 #include <string>
 #include <vector>
 
+#include "ioda/distribution/PendingReduction.h"
+
 namespace eckit {
 namespace mpi {
 class Comm;
@@ -51,6 +53,69 @@ double dotProduct(const Distribution &dist, std::size_t numVariables,
 double dotProduct(const Distribution &dist, std::size_t numVariables,
                   const std::vector<int64_t> &v1, const std::vector<int64_t> &v2);
 
+/// \brief Computes the dot products of the observations of each variable stored in two vectors
+/// of obs distributed across MPI ranks.
+///
+/// The vectors are traversed once and the results for all variables are reduced across MPI
+/// ranks in a single collective operation.
+///
+/// \param distribution
+///   Distribution used to partition observations across MPI ranks.
+/// \param numVariables
+///   Number of variables whose observations are stored in `v1` and `v2`.
+/// \param v1, v2
+///   Vectors of observations, with the observations of individual variables interleaved as in
+///   dotProduct().
+///
+/// \return A vector whose element `ivar` is the dot product of the observations of variable
+/// `ivar`, computed as in dotProduct().
+///
+/// \relates Distribution
+std::vector<double> dotProductPerVariable(const Distribution &dist, std::size_t numVariables,
+                                          const std::vector<double> &v1,
+                                          const std::vector<double> &v2);
+std::vector<double> dotProductPerVariable(const Distribution &dist, std::size_t numVariables,
+                                          const std::vector<float> &v1,
+                                          const std::vector<float> &v2);
+std::vector<double> dotProductPerVariable(const Distribution &dist, std::size_t numVariables,
+                                          const std::vector<int> &v1,
+                                          const std::vector<int> &v2);
+std::vector<double> dotProductPerVariable(const Distribution &dist, std::size_t numVariables,
+                                          const std::vector<int64_t> &v1,
+                                          const std::vector<int64_t> &v2);
+
+/// \brief Non-blocking versions of dotProduct() and dotProductPerVariable().
+///
+/// The local part of the calculation is done before returning; the reduction across MPI ranks
+/// is left in flight and the result is obtained by calling get() on the returned handle.
+/// Reductions started on all ranks in the same order may be in flight together.
+///
+/// \relates Distribution
+PendingReduction<double> iDotProduct(const Distribution &dist, std::size_t numVariables,
+                                     const std::vector<double> &v1,
+                                     const std::vector<double> &v2);
+PendingReduction<double> iDotProduct(const Distribution &dist, std::size_t numVariables,
+                                     const std::vector<float> &v1,
+                                     const std::vector<float> &v2);
+PendingReduction<double> iDotProduct(const Distribution &dist, std::size_t numVariables,
+                                     const std::vector<int> &v1,
+                                     const std::vector<int> &v2);
+PendingReduction<double> iDotProduct(const Distribution &dist, std::size_t numVariables,
+                                     const std::vector<int64_t> &v1,
+                                     const std::vector<int64_t> &v2);
+PendingReduction<std::vector<double>> iDotProductPerVariable(
+    const Distribution &dist, std::size_t numVariables,
+    const std::vector<double> &v1, const std::vector<double> &v2);
+PendingReduction<std::vector<double>> iDotProductPerVariable(
+    const Distribution &dist, std::size_t numVariables,
+    const std::vector<float> &v1, const std::vector<float> &v2);
+PendingReduction<std::vector<double>> iDotProductPerVariable(
+    const Distribution &dist, std::size_t numVariables,
+    const std::vector<int> &v1, const std::vector<int> &v2);
+PendingReduction<std::vector<double>> iDotProductPerVariable(
+    const Distribution &dist, std::size_t numVariables,
+    const std::vector<int64_t> &v1, const std::vector<int64_t> &v2);
+
 /// \brief Counts unique non-missing observations in a vector.
 ///
 /// \param distribution
@@ -80,6 +145,29 @@ std::size_t globalNumNonMissingObs(const Distribution &dist,
 std::size_t globalNumNonMissingObs(const Distribution &dist,
                                    size_t numVariables, const std::vector<bool> &v);
 
+/// \brief Non-blocking version of globalNumNonMissingObs(). Call get() on the returned handle
+/// to obtain the result.
+///
+/// \relates Distribution
+PendingReduction<std::size_t> iGlobalNumNonMissingObs(const Distribution &dist,
+                                                      size_t numVariables,
+                                                      const std::vector<double> &v);
+PendingReduction<std::size_t> iGlobalNumNonMissingObs(const Distribution &dist,
+                                                      size_t numVariables,
+                                                      const std::vector<float> &v);
+PendingReduction<std::size_t> iGlobalNumNonMissingObs(const Distribution &dist,
+                                                      size_t numVariables,
+                                                      const std::vector<int> &v);
+PendingReduction<std::size_t> iGlobalNumNonMissingObs(const Distribution &dist,
+                                                      size_t numVariables,
+                                                      const std::vector<std::string> &v);
+PendingReduction<std::size_t> iGlobalNumNonMissingObs(const Distribution &dist,
+                                                      size_t numVariables,
+                                                      const std::vector<util::DateTime> &v);
+PendingReduction<std::size_t> iGlobalNumNonMissingObs(const Distribution &dist,
+                                                      size_t numVariables,
+                                                      const std::vector<bool> &v);
+
 /// \brief Create a suitable replica distribution for the distribution `master`.
 ///
 /// A replica distribution assigns each record `r` to a process if and only if another distribution
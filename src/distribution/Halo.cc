@@ -8,9 +8,13 @@
 #include "ioda/distribution/Halo.h"
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include <numeric>
 #include <set>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <boost/make_unique.hpp>
@@ -28,6 +32,10 @@ namespace ioda {
 // -----------------------------------------------------------------------------
 static DistributionMaker<Halo> maker("Halo");
 
+// -----------------------------------------------------------------------------
+// Conversion factor from degrees to radians
+static const double deg2rad = M_PI / 180.0;
+
 // -----------------------------------------------------------------------------
 /*!
  * \brief Halo selector
@@ -67,6 +75,26 @@ Halo::Halo(const eckit::mpi::Comm & Comm,
 
   radius_ += haloSize;
 
+  // Set up the prefilter used to reject points far away from the center without computing
+  // their great-circle distance. A point is rejected when its latitude differs from the
+  // latitude of the center by more than the angular radius of the halo, or when the angle
+  // between the unit vectors of the point and the center is larger than the angular radius.
+  // A small margin keeps points near the halo boundary for the exact distance check.
+  const double angularRadius = radius_ / radius_earth_;
+  const double margin = 1.0e-9;
+  if (angularRadius + margin >= M_PI) {
+    maxLatDiff_ = std::numeric_limits<double>::infinity();
+    minCosAngle_ = -std::numeric_limits<double>::infinity();
+  } else {
+    maxLatDiff_ = (angularRadius + margin) / deg2rad;
+    minCosAngle_ = std::cos(angularRadius) - margin;
+  }
+  const double centerLon = center_[0] * deg2rad;
+  const double centerLat = center_[1] * deg2rad;
+  centerUnitVector_[0] = std::cos(centerLat) * std::cos(centerLon);
+  centerUnitVector_[1] = std::cos(centerLat) * std::sin(centerLon);
+  centerUnitVector_[2] = std::sin(centerLat);
+
   oops::Log::debug() << "Halo constructed: center: " << center_ << " radius: "
                      << radius_ << " haloSize: " << haloSize << std::endl;
 }
@@ -79,31 +107,78 @@ Halo::~Halo() {
 // -----------------------------------------------------------------------------
 void Halo::assignRecord(const std::size_t RecNum, const std::size_t LocNum,
                         const eckit::geometry::Point2 & point) {
+  assignRecordImpl(RecNum, LocNum, point, mayBeInHalo(point[0], point[1]));
+}
+
+// -----------------------------------------------------------------------------
+void Halo::assignRecords(const std::vector<std::size_t> & RecNums,
+                         const std::vector<std::size_t> & LocNums,
+                         const std::vector<eckit::geometry::Point2> & points,
+                         std::vector<bool> & isMine) {
+  // Run the prefilter over all the points in one pass, then assign the records in order.
+  std::vector<unsigned char> candidates(points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    candidates[i] = mayBeInHalo(points[i][0], points[i][1]);
+  }
+  isMine.resize(points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    if (i > 0 && RecNums[i] == RecNums[i - 1]) {
+      // Same record as the previous location, which has already been assigned.
+      isMine[i] = isMine[i - 1];
+      if (isMine[i]) {
+        haloLocVector_.push_back(LocNums[i]);
+        haloLocRecords_.push_back(RecNums[i]);
+      }
+    } else {
+      isMine[i] = assignRecordImpl(RecNums[i], LocNums[i], points[i], candidates[i]);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool Halo::mayBeInHalo(const double lon, const double lat) const {
+  if (std::abs(lat - center_[1]) > maxLatDiff_)
+    return false;
+  const double lonRad = lon * deg2rad;
+  const double latRad = lat * deg2rad;
+  const double cosLat = std::cos(latRad);
+  const double cosAngle = cosLat * std::cos(lonRad) * centerUnitVector_[0] +
+                          cosLat * std::sin(lonRad) * centerUnitVector_[1] +
+                          std::sin(latRad) * centerUnitVector_[2];
+  return cosAngle >= minCosAngle_;
+}
+
+// -----------------------------------------------------------------------------
+bool Halo::assignRecordImpl(const std::size_t RecNum, const std::size_t LocNum,
+                            const eckit::geometry::Point2 & point, const bool candidate) {
   if (recordsOutsideHalo_.find(RecNum) != recordsOutsideHalo_.end()) {
     // We've already seen the first location in this record, and it was too far away from center_.
-    return;
+    return false;
   }
 
   if (recordsInHalo_.find(RecNum) == recordsInHalo_.end()) {
     // This is the first location from this record. Find out whether to assign it to this PE.
-
-    const double dist = eckit::geometry::Sphere::distance(radius_earth_, center_, point);
-    oops::Log::debug() << "Point: " << point << " distance to center: " << center_
-          << " = " << dist << std::endl;
-    if (dist <= radius_) {
+    // Points rejected by the prefilter are certainly too far from center_. For the others,
+    // the great-circle distance decides.
+    double dist = 0.0;
+    if (candidate) {
+      dist = eckit::geometry::Sphere::distance(radius_earth_, center_, point);
+    }
+    if (candidate && dist <= radius_) {
       // Yes!
       recordsInHalo_.insert(RecNum);
       recordDistancesFromCenter_[RecNum] = dist;
     } else {
       // No, it's too far from center_.
       recordsOutsideHalo_.insert(RecNum);
-      return;
+      return false;
     }
   }
 
   // Now we know this record has been assigned to this PE. Store information about location LocNum.
   haloLocVector_.push_back(LocNum);
   haloLocRecords_.push_back(RecNum);
+  return true;
 }
 
 // -----------------------------------------------------------------------------
@@ -113,57 +188,73 @@ bool Halo::isMyRecord(std::size_t RecNum) const {
 
 // -----------------------------------------------------------------------------
 void Halo::computePatchLocs() {
-  // define some constants for this PE
-  double inf = std::numeric_limits<double>::infinity();
-  size_t myRank = comm_.rank();
-
   // All records have now been assigned, so this container is no longer needed.
   recordsOutsideHalo_.clear();
 
   // Find the maximum global location index (plus 1)
   size_t nglocs = 0;
   if (!haloLocVector_.empty())
-    nglocs = haloLocVector_.back() + 1;
+    nglocs = *std::max_element(haloLocVector_.begin(), haloLocVector_.end()) + 1;
   comm_.allReduceInPlace(nglocs, eckit::mpi::max());
 
   if ( nglocs > 0 ) {
-    // make structures holding pairs of {distance,rank} for reduce operation later
-    // initialize the local array to dist == inf
-    std::vector<std::pair<double, int>> dist_and_lidx_loc(nglocs);
-    std::vector<std::pair<double, int>> dist_and_lidx_glb(nglocs);
-    for ( size_t jj = 0; jj < nglocs; ++jj ) {
-      dist_and_lidx_loc[jj] = std::make_pair(inf, myRank);
-    }
-
-    // assign actual distances to local obs (stored in haloLocVector_)
+    // Each global location index has a "home" PE, given by a block distribution of the
+    // indices over the PEs. Send the halo locations held on this PE, along with the distance
+    // of their record to the center of this PE's halo, to their home PEs. Only locations
+    // that are held somewhere are communicated, rather than arrays of size nglocs.
+    const size_t nranks = comm_.size();
+    std::vector<std::vector<size_t>> haloLocsByHome(nranks);
+    std::vector<std::vector<double>> haloDistsByHome(nranks);
     for (size_t loc = 0; loc < haloLocVector_.size(); ++loc) {
       const size_t gloc = haloLocVector_[loc];
-      const size_t recNum = haloLocRecords_[loc];
-      const double dist = recordDistancesFromCenter_.at(recNum);
-      dist_and_lidx_loc[gloc] = std::make_pair(dist, myRank);
+      const size_t home = homeRank(gloc, nglocs);
+      haloLocsByHome[home].push_back(gloc);
+      haloDistsByHome[home].push_back(recordDistancesFromCenter_.at(haloLocRecords_[loc]));
     }
-
-    // use reduce operation to find PE rank with minimal distance
-    comm_.allReduce(dist_and_lidx_loc, dist_and_lidx_glb, eckit::mpi::minloc());
-
-    // ids of patch observations owned by this PE
-    std::unordered_set<std::size_t> patchObsLoc;
-
-    // if this PE has the minimum distance then this PE owns this ob. as patch
-    for (auto i : haloLocVector_) {
-      if ( dist_and_lidx_glb[i].second == myRank ) {
-        patchObsLoc.insert(i);
+    std::vector<std::vector<size_t>> homeLocsBySource;
+    std::vector<std::vector<double>> homeDistsBySource;
+    comm_.allToAll(haloLocsByHome, homeLocsBySource);
+    comm_.allToAll(haloDistsByHome, homeDistsBySource);
+
+    // On the home PE, the PE owning a location as a patch obs is the one with the minimum
+    // distance, with ties going to the lowest rank (as the MPI_MINLOC reduction does).
+    // Tell every PE holding the location which PE owns it.
+    std::unordered_map<size_t, std::pair<double, int>> homeLocOwners;
+    for (size_t source = 0; source < nranks; ++source) {
+      for (size_t i = 0; i < homeLocsBySource[source].size(); ++i) {
+        const std::pair<double, int> candidate(homeDistsBySource[source][i],
+                                               static_cast<int>(source));
+        auto owner = homeLocOwners.emplace(homeLocsBySource[source][i], candidate);
+        if (!owner.second && candidate < owner.first->second) {
+          owner.first->second = candidate;
+        }
       }
     }
-
-    // convert storage from unodered sets to a bool vector
-    for (size_t jj = 0; jj < haloLocVector_.size(); ++jj) {
-      if ( patchObsLoc.count(haloLocVector_[jj]) ) {
-        patchObsBool_.push_back(true);
-      } else {
-        patchObsBool_.push_back(false);
+    homeDistsBySource.clear();
+    std::vector<std::vector<int>> ownersBySource(nranks);
+    for (size_t source = 0; source < nranks; ++source) {
+      ownersBySource[source].reserve(homeLocsBySource[source].size());
+      for (size_t gloc : homeLocsBySource[source]) {
+        ownersBySource[source].push_back(homeLocOwners.at(gloc).second);
       }
     }
+    std::vector<std::vector<int>> ownersByHome;
+    comm_.allToAll(ownersBySource, ownersByHome);
+
+    // The owners come back in the order in which the locations were sent.
+    std::vector<int> haloLocOwners(haloLocVector_.size());
+    std::vector<size_t> nextFromHome(nranks, 0);
+    for (size_t loc = 0; loc < haloLocVector_.size(); ++loc) {
+      const size_t home = homeRank(haloLocVector_[loc], nglocs);
+      haloLocOwners[loc] = ownersByHome[home][nextFromHome[home]++];
+    }
+
+    // if this PE has the minimum distance then this PE owns this ob. as patch
+    const int myRank = comm_.rank();
+    patchObsBool_.resize(haloLocVector_.size());
+    for (size_t loc = 0; loc < haloLocVector_.size(); ++loc) {
+      patchObsBool_[loc] = (haloLocOwners[loc] == myRank);
+    }
 
     size_t npatchobs = std::count(patchObsBool_.begin(), patchObsBool_.end(), true);
     oops::Log::debug() << "npatchobs: " << npatchobs << std::endl;
@@ -174,7 +265,7 @@ void Halo::computePatchLocs() {
     haloLocRecords_.clear();
     haloLocRecords_.shrink_to_fit();
 
-    computeGlobalUniqueConsecutiveLocIndices(dist_and_lidx_glb);
+    computeGlobalUniqueConsecutiveLocIndices(nglocs, homeLocsBySource, ownersBySource);
 
     // and now the remaining temp object
     haloLocVector_.clear();
@@ -182,49 +273,82 @@ void Halo::computePatchLocs() {
   }
 }
 
+// -----------------------------------------------------------------------------
+size_t Halo::homeRank(const size_t gloc, const size_t nglocs) const {
+  return gloc * comm_.size() / nglocs;
+}
+
 // -----------------------------------------------------------------------------
 void Halo::computeGlobalUniqueConsecutiveLocIndices(
-    const std::vector<std::pair<double, int>> &dist_and_lidx_glb) {
-  const double inf = std::numeric_limits<double>::infinity();
-
-  globalUniqueConsecutiveLocIndices_.reserve(haloLocVector_.size());
-
-  // Step 0: enable quick checks of whether a location belongs to this rank's halo.
-  std::unordered_set<size_t> haloLocSet(haloLocVector_.begin(), haloLocVector_.end());
-
-  // Step 1: index patch observations owned by each rank consecutively (starting from 0 on each
-  // rank). For each observation i held on this rank, set globalConsecutiveLocIndices_[i] to
-  // the index of the corresponding patch observation on the rank that owns it.
-  std::vector<size_t> patchObsCountOnRank(comm_.size(), 0);
-  for (size_t gloc = 0, nglocs = dist_and_lidx_glb.size(); gloc < nglocs; ++gloc) {
-    if (dist_and_lidx_glb[gloc].first < inf) {
-      // This obs is held on at least one rank (this won't be the case e.g. for observations
-      // outside the assimilation window)
-      const size_t rankOwningPatchObs = dist_and_lidx_glb[gloc].second;
-      if (haloLocSet.find(gloc) != haloLocSet.end()) {
-        // This obs is held on the current PE (but not necessarily as a patch obs)
-        globalUniqueConsecutiveLocIndices_.push_back(patchObsCountOnRank[rankOwningPatchObs]);
+    const size_t nglocs, const std::vector<std::vector<size_t>> &homeLocsBySource,
+    const std::vector<std::vector<int>> &homeOwnersBySource) {
+  const size_t nranks = comm_.size();
+
+  // Patch observations are indexed consecutively, first by the rank owning them and then
+  // by their global location index.
+
+  // Step 1: index the patch observations owned by this rank consecutively (starting from 0)
+  // in order of their global location index, then make the indices globally unique by adding
+  // the total number of patch observations owned by ranks r' < r (an exclusive scan).
+  std::vector<size_t> patchLocIndices;
+  for (size_t loc = 0; loc < haloLocVector_.size(); ++loc) {
+    if (patchObsBool_[loc])
+      patchLocIndices.push_back(loc);
+  }
+  std::sort(patchLocIndices.begin(), patchLocIndices.end(),
+            [this](size_t a, size_t b) { return haloLocVector_[a] < haloLocVector_[b]; });
+
+  size_t patchObsCountOnPreviousRanks = patchLocIndices.size();
+  oops::mpi::exclusiveScan(comm_, patchObsCountOnPreviousRanks);
+
+  std::vector<size_t> patchIndices(haloLocVector_.size(), 0);
+  for (size_t i = 0; i < patchLocIndices.size(); ++i)
+    patchIndices[patchLocIndices[i]] = patchObsCountOnPreviousRanks + i;
+  patchLocIndices.clear();
+  patchLocIndices.shrink_to_fit();
+
+  // Step 2: send the index of each patch observation to the home PE of its location. The
+  // home PE already knows which locations this PE owns and in which order they were sent to
+  // it in computePatchLocs(), so only the indices need to be sent.
+  std::vector<std::vector<size_t>> patchIndicesByHome(nranks);
+  for (size_t loc = 0; loc < haloLocVector_.size(); ++loc) {
+    if (patchObsBool_[loc])
+      patchIndicesByHome[homeRank(haloLocVector_[loc], nglocs)].push_back(patchIndices[loc]);
+  }
+  patchIndices.clear();
+  patchIndices.shrink_to_fit();
+  std::vector<std::vector<size_t>> homePatchIndicesBySource;
+  comm_.allToAll(patchIndicesByHome, homePatchIndicesBySource);
+  patchIndicesByHome.clear();
+
+  std::unordered_map<size_t, size_t> homePatchIndices;
+  for (size_t source = 0; source < nranks; ++source) {
+    size_t next = 0;
+    for (size_t i = 0; i < homeLocsBySource[source].size(); ++i) {
+      if (homeOwnersBySource[source][i] == static_cast<int>(source)) {
+        homePatchIndices[homeLocsBySource[source][i]] = homePatchIndicesBySource[source][next++];
       }
-      ++patchObsCountOnRank[rankOwningPatchObs];
     }
   }
-
-  // Step 2: make indices of patch observations globally unique by incrementing the index
-  // of each patch observation held by rank r by the total number of patch observations owned
-  // by ranks r' < r.
-
-  // Perform an exclusive scan
-  std::vector<size_t> patchObsCountOnPreviousRanks(patchObsCountOnRank.size(), 0);
-  for (size_t rank = 1; rank < patchObsCountOnRank.size(); ++rank) {
-    patchObsCountOnPreviousRanks[rank] =
-        patchObsCountOnPreviousRanks[rank - 1] + patchObsCountOnRank[rank - 1];
+  homePatchIndicesBySource.clear();
+
+  // Step 3: the home PE returns the index to every PE holding the location (as a patch obs
+  // or not), in the order in which the locations were sent to it.
+  std::vector<std::vector<size_t>> indicesBySource(nranks);
+  for (size_t source = 0; source < nranks; ++source) {
+    indicesBySource[source].reserve(homeLocsBySource[source].size());
+    for (size_t gloc : homeLocsBySource[source]) {
+      indicesBySource[source].push_back(homePatchIndices.at(gloc));
+    }
   }
-
-  // Increment patch observation indices
-  for (size_t loc = 0; loc < globalUniqueConsecutiveLocIndices_.size(); ++loc) {
-    const size_t gloc = haloLocVector_[loc];
-    const size_t rankOwningPatchObs = dist_and_lidx_glb[gloc].second;
-    globalUniqueConsecutiveLocIndices_[loc] += patchObsCountOnPreviousRanks[rankOwningPatchObs];
+  std::vector<std::vector<size_t>> indicesByHome;
+  comm_.allToAll(indicesBySource, indicesByHome);
+
+  globalUniqueConsecutiveLocIndices_.resize(haloLocVector_.size());
+  std::vector<size_t> nextFromHome(nranks, 0);
+  for (size_t loc = 0; loc < haloLocVector_.size(); ++loc) {
+    const size_t home = homeRank(haloLocVector_[loc], nglocs);
+    globalUniqueConsecutiveLocIndices_[loc] = indicesByHome[home][nextFromHome[home]++];
   }
 }
 
@@ -8,6 +8,7 @@
 #ifndef DISTRIBUTION_HALO_H_
 #define DISTRIBUTION_HALO_H_
 
+#include <array>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -53,6 +54,12 @@ class Halo: public Distribution {
 
      void assignRecord(const std::size_t RecNum, const std::size_t LocNum,
                       const eckit::geometry::Point2 & point) override;
+     /// Runs the distance prefilter over the whole batch in one pass, then assigns the
+     /// records in order.
+     void assignRecords(const std::vector<std::size_t> & RecNums,
+                        const std::vector<std::size_t> & LocNums,
+                        const std::vector<eckit::geometry::Point2> & points,
+                        std::vector<bool> & isMine) override;
      bool isMyRecord(std::size_t RecNum) const override;
      void computePatchLocs() override;
      void patchObs(std::vector<bool> &) const override;
@@ -122,11 +129,38 @@ class Halo: public Distribution {
      template <typename T>
      void allGathervImpl(std::vector<T> &x) const;
 
+     /// Returns false if the point is certainly further than radius_ from center_, true if it
+     /// may be within radius_ (the great-circle distance then needs to be checked).
+     bool mayBeInHalo(double lon, double lat) const;
+
+     /// Implementation of assignRecord(); `candidate` is the result of mayBeInHalo() for
+     /// `point`. Returns true if the record has been assigned to this PE.
+     bool assignRecordImpl(std::size_t RecNum, std::size_t LocNum,
+                           const eckit::geometry::Point2 & point, bool candidate);
+
+     /// Returns the PE responsible for resolving the ownership of the location with global
+     /// index `gloc`. The global location indices are block distributed over the PEs.
+     size_t homeRank(size_t gloc, size_t nglocs) const;
+
+     /// Fills globalUniqueConsecutiveLocIndices_ once patchObsBool_ is known.
+     ///
+     /// \param homeLocsBySource
+     ///   Global indices of the locations this PE is the home of, grouped by the PE that
+     ///   holds them.
+     /// \param homeOwnersBySource
+     ///   PEs owning the locations in `homeLocsBySource` as patch obs.
      void computeGlobalUniqueConsecutiveLocIndices(
-         const std::vector<std::pair<double, int>> &dist_and_lidx_glb);
+         size_t nglocs, const std::vector<std::vector<size_t>> &homeLocsBySource,
+         const std::vector<std::vector<int>> &homeOwnersBySource);
 
      double radius_;
      eckit::geometry::Point2 center_;
+     // Prefilter settings: maximum latitude difference (in degrees) and minimum cosine of the
+     // angle between a point and center_ for the point to possibly lie within radius_.
+     double maxLatDiff_;
+     double minCosAngle_;
+     // Unit vector pointing to center_
+     std::array<double, 3> centerUnitVector_;
      // Record numbers held on this PE
      std::unordered_set<std::size_t> recordsInHalo_;
      // Indicates which observations held on this PE are "patch obs".
@@ -39,6 +39,18 @@ class InefficientDistribution: public Distribution {
 
      bool isMyRecord(std::size_t RecNum) const override {return true;};
 
+     void assignRecords(const std::vector<std::size_t> & RecNums,
+                        const std::vector<std::size_t> & LocNums,
+                        const std::vector<eckit::geometry::Point2> & points,
+                        std::vector<bool> & isMine) override {
+       isMine.assign(RecNums.size(), true);
+     }
+
+     void flagMyRecords(const std::vector<std::size_t> & RecNums,
+                        std::vector<bool> & isMine) const override {
+       isMine.assign(RecNums.size(), true);
+     }
+
      void patchObs(std::vector<bool> &) const override;
 
      // The min and max reductions do nothing for the inefficient distribution. Each processor has
@@ -0,0 +1,92 @@
+/*
+ * (C) Copyright 2022 UCAR
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ */
+
+#include "ioda/distribution/LoadBalanced.h"
+
+#include <iostream>
+
+#include "eckit/mpi/Comm.h"
+#include "ioda/distribution/DistributionFactory.h"
+#include "oops/util/Logger.h"
+
+namespace ioda {
+
+// -----------------------------------------------------------------------------
+static DistributionMaker<LoadBalanced> maker("LoadBalanced");
+
+constexpr int LoadBalanced::unassigned;
+
+// -----------------------------------------------------------------------------
+LoadBalanced::LoadBalanced(const eckit::mpi::Comm & Comm,
+                           const Parameters_ &)
+                           : NonoverlappingDistribution(Comm),
+                             numLocsOnRank_(Comm.size(), 0) {
+  for (int rank = 0; rank < static_cast<int>(Comm.size()); ++rank)
+    rankLoads_.emplace(0, rank);
+  oops::Log::trace() << "LoadBalanced constructed" << std::endl;
+}
+
+// -----------------------------------------------------------------------------
+LoadBalanced::~LoadBalanced() {
+  oops::Log::trace() << "LoadBalanced destructed" << std::endl;
+}
+
+// -----------------------------------------------------------------------------
+std::string LoadBalanced::name() const {
+  return "LoadBalanced";
+}
+
+// -----------------------------------------------------------------------------
+void LoadBalanced::addLocation(const std::size_t RecNum) {
+  if (RecNum >= recordOwners_.size())
+    recordOwners_.resize(RecNum + 1, unassigned);
+
+  int & owner = recordOwners_[RecNum];
+  if (owner == unassigned)
+    owner = rankLoads_.begin()->second;
+
+  std::size_t & numLocs = numLocsOnRank_[owner];
+  rankLoads_.erase(std::make_pair(numLocs, owner));
+  ++numLocs;
+  rankLoads_.emplace(numLocs, owner);
+}
+
+// -----------------------------------------------------------------------------
+void LoadBalanced::assignRecord(const std::size_t RecNum, const std::size_t LocNum,
+                                const eckit::geometry::Point2 & point) {
+  addLocation(RecNum);
+  NonoverlappingDistribution::assignRecord(RecNum, LocNum, point);
+}
+
+// -----------------------------------------------------------------------------
+void LoadBalanced::assignRecords(const std::vector<std::size_t> & RecNums,
+                                 const std::vector<std::size_t> & LocNums,
+                                 const std::vector<eckit::geometry::Point2> & points,
+                                 std::vector<bool> & isMine) {
+  for (const std::size_t RecNum : RecNums)
+    addLocation(RecNum);
+  NonoverlappingDistribution::assignRecords(RecNums, LocNums, points, isMine);
+}
+
+// -----------------------------------------------------------------------------
+bool LoadBalanced::isMyRecord(std::size_t RecNum) const {
+  return RecNum < recordOwners_.size() &&
+         recordOwners_[RecNum] == static_cast<int>(comm_.rank());
+}
+
+// -----------------------------------------------------------------------------
+void LoadBalanced::flagMyRecords(const std::vector<std::size_t> & RecNums,
+                                 std::vector<bool> & isMine) const {
+  const int myRank = comm_.rank();
+  isMine.resize(RecNums.size());
+  for (std::size_t i = 0; i < RecNums.size(); ++i)
+    isMine[i] = RecNums[i] < recordOwners_.size() && recordOwners_[RecNums[i]] == myRank;
+}
+
+// -----------------------------------------------------------------------------
+
+}  // namespace ioda
@@ -0,0 +1,78 @@
+/*
+ * (C) Copyright 2022 UCAR
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ */
+
+#ifndef DISTRIBUTION_LOADBALANCED_H_
+#define DISTRIBUTION_LOADBALANCED_H_
+
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ioda/distribution/NonoverlappingDistribution.h"
+#include "ioda/distribution/DistributionParametersBase.h"
+
+namespace ioda {
+
+// ---------------------------------------------------------------------
+/*!
+ * \brief Load-balanced distribution
+ *
+ * \details This class implements a distribution that equalises the number of locations
+ *          held on each process element. When the first location of a record is assigned,
+ *          the record goes to the process element holding the fewest locations so far
+ *          (the lowest rank on a tie). Every process element sees the same sequence of
+ *          assignRecord() calls, so all of them reach the same decisions without any
+ *          communication and the result does not change from run to run.
+ *
+ *          Unlike RoundRobin, which balances the number of records, this keeps the number
+ *          of locations per process element within one record size of each other when
+ *          records vary in length (e.g. sondes or profiles).
+ */
+class LoadBalanced: public NonoverlappingDistribution {
+ public:
+    typedef EmptyDistributionParameters Parameters_;
+
+    LoadBalanced(const eckit::mpi::Comm & Comm,
+                 const Parameters_ &);
+    ~LoadBalanced() override;
+
+    void assignRecord(const std::size_t RecNum, const std::size_t LocNum,
+                      const eckit::geometry::Point2 & point) override;
+    void assignRecords(const std::vector<std::size_t> & RecNums,
+                       const std::vector<std::size_t> & LocNums,
+                       const std::vector<eckit::geometry::Point2> & points,
+                       std::vector<bool> & isMine) override;
+
+    bool isMyRecord(std::size_t RecNum) const override;
+    void flagMyRecords(const std::vector<std::size_t> & RecNums,
+                       std::vector<bool> & isMine) const override;
+
+    std::string name() const override;
+
+ private:
+    /// Assigns record `RecNum` to the least loaded process element if this is its first
+    /// location, then adds the location to the load of the record's owner.
+    void addLocation(std::size_t RecNum);
+
+    /// Value of recordOwners_ for records that haven't been assigned yet.
+    static constexpr int unassigned = -1;
+
+    /// Rank owning each record, indexed by record number.
+    std::vector<int> recordOwners_;
+
+    /// Number of locations assigned to each rank so far, as (count, rank) pairs so that the
+    /// first element is the least loaded rank (the lowest one on a tie).
+    std::set<std::pair<std::size_t, int>> rankLoads_;
+
+    /// Number of locations assigned to each rank so far, indexed by rank.
+    std::vector<std::size_t> numLocsOnRank_;
+};
+
+}  // namespace ioda
+
+#endif  // DISTRIBUTION_LOADBALANCED_H_
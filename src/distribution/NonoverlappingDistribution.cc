@@ -41,6 +41,16 @@ void NonoverlappingDistribution::assignRecord(const std::size_t RecNum,
     ++numLocationsOnThisRank_;
 }
 
+// -----------------------------------------------------------------------------
+void NonoverlappingDistribution::assignRecords(
+    const std::vector<std::size_t> & RecNums,
+    const std::vector<std::size_t> & /*LocNums*/,
+    const std::vector<eckit::geometry::Point2> & /*points*/,
+    std::vector<bool> & isMine) {
+  flagMyRecords(RecNums, isMine);
+  numLocationsOnThisRank_ += std::count(isMine.begin(), isMine.end(), true);
+}
+
 // -----------------------------------------------------------------------------
 void NonoverlappingDistribution::computePatchLocs() {
   numLocationsOnLowerRanks_ = numLocationsOnThisRank_;
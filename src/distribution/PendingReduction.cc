@@ -0,0 +1,131 @@
+/*
+ * (C) Copyright 2022 UCAR
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ */
+
+#include "ioda/distribution/PendingReduction.h"
+
+#include <mpi.h>
+
+#include <cstdint>
+#include <utility>
+
+#include "eckit/exception/Exceptions.h"
+
+namespace ioda {
+
+namespace {
+
+MPI_Datatype mpiType(const int *) { return MPI_INT; }
+MPI_Datatype mpiType(const float *) { return MPI_FLOAT; }
+MPI_Datatype mpiType(const double *) { return MPI_DOUBLE; }
+MPI_Datatype mpiType(const std::size_t *) {
+  static_assert(sizeof(std::size_t) == sizeof(std::uint64_t), "size_t must be 64 bits wide");
+  return MPI_UINT64_T;
+}
+
+MPI_Op mpiOp(const eckit::mpi::Operation::Code op) {
+  switch (op) {
+    case eckit::mpi::Operation::SUM:
+      return MPI_SUM;
+    case eckit::mpi::Operation::MIN:
+      return MPI_MIN;
+    case eckit::mpi::Operation::MAX:
+      return MPI_MAX;
+    default:
+      throw eckit::BadParameter("PendingReduction: unsupported reduction operation", Here());
+  }
+}
+
+template <typename T>
+T * bufferData(T & x) { return &x; }
+template <typename T>
+T * bufferData(std::vector<T> & x) { return x.data(); }
+
+template <typename T>
+int bufferSize(const T &) { return 1; }
+template <typename T>
+int bufferSize(const std::vector<T> & x) { return static_cast<int>(x.size()); }
+
+}  // namespace
+
+// -----------------------------------------------------------------------------
+template <typename T>
+struct PendingReduction<T>::State {
+  explicit State(T value) : buffer(std::move(value)) {}
+
+  T buffer;
+  MPI_Request request = MPI_REQUEST_NULL;
+};
+
+// -----------------------------------------------------------------------------
+template <typename T>
+PendingReduction<T>::PendingReduction(T result)
+  : state_(new State(std::move(result)))
+{}
+
+// -----------------------------------------------------------------------------
+template <typename T>
+PendingReduction<T>::PendingReduction(T localValue, eckit::mpi::Operation::Code op,
+                                      const eckit::mpi::Comm & comm)
+  : state_(new State(std::move(localValue)))
+{
+  // The state is heap-allocated, so the buffer stays put while the handle is moved around.
+  auto data = bufferData(state_->buffer);
+  MPI_Iallreduce(MPI_IN_PLACE, data, bufferSize(state_->buffer), mpiType(data), mpiOp(op),
+                 MPI_Comm_f2c(comm.communicator()), &state_->request);
+}
+
+// -----------------------------------------------------------------------------
+template <typename T>
+PendingReduction<T>::PendingReduction(PendingReduction &&) noexcept = default;
+
+template <typename T>
+PendingReduction<T> & PendingReduction<T>::operator=(PendingReduction && other) noexcept {
+  if (this != &other) {
+    if (state_ && state_->request != MPI_REQUEST_NULL)
+      MPI_Wait(&state_->request, MPI_STATUS_IGNORE);
+    state_ = std::move(other.state_);
+  }
+  return *this;
+}
+
+// -----------------------------------------------------------------------------
+template <typename T>
+PendingReduction<T>::~PendingReduction() {
+  // MPI requires the buffer of a non-blocking collective to stay valid until it completes.
+  if (state_ && state_->request != MPI_REQUEST_NULL)
+    MPI_Wait(&state_->request, MPI_STATUS_IGNORE);
+}
+
+// -----------------------------------------------------------------------------
+template <typename T>
+bool PendingReduction<T>::test() {
+  if (state_->request == MPI_REQUEST_NULL)
+    return true;
+  int completed = 0;
+  MPI_Test(&state_->request, &completed, MPI_STATUS_IGNORE);
+  return completed != 0;
+}
+
+// -----------------------------------------------------------------------------
+template <typename T>
+const T & PendingReduction<T>::get() {
+  if (state_->request != MPI_REQUEST_NULL)
+    MPI_Wait(&state_->request, MPI_STATUS_IGNORE);
+  return state_->buffer;
+}
+
+// -----------------------------------------------------------------------------
+template class PendingReduction<int>;
+template class PendingReduction<std::size_t>;
+template class PendingReduction<float>;
+template class PendingReduction<double>;
+template class PendingReduction<std::vector<int>>;
+template class PendingReduction<std::vector<std::size_t>>;
+template class PendingReduction<std::vector<float>>;
+template class PendingReduction<std::vector<double>>;
+
+}  // namespace ioda
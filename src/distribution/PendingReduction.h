@@ -0,0 +1,57 @@
+/*
+ * (C) Copyright 2022 UCAR
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ */
+
+#ifndef DISTRIBUTION_PENDINGREDUCTION_H_
+#define DISTRIBUTION_PENDINGREDUCTION_H_
+
+#include <memory>
+#include <vector>
+
+#include "eckit/mpi/Comm.h"
+
+namespace ioda {
+
+/// \brief Handle to a reduction over all PEs of a communicator that may still be in progress.
+///
+/// The reduction is started with a non-blocking collective (MPI_Iallreduce) when the handle is
+/// created, so several reductions can be in flight at the same time and overlap with local
+/// computations. get() waits for the reduction to complete and returns its result.
+///
+/// As with any non-blocking collective, all PEs must start their reductions in the same order.
+///
+/// `T` must be `int`, `size_t`, `float`, `double` or a vector of one of these types. Vectors are
+/// reduced element by element.
+template <typename T>
+class PendingReduction {
+ public:
+    /// \brief Create a handle to a reduction that has already completed with result `result`.
+    explicit PendingReduction(T result);
+
+    /// \brief Start reducing `localValue` over all PEs of `comm` with the operation `op`, which
+    /// must be eckit::mpi::Operation::SUM, MIN or MAX.
+    PendingReduction(T localValue, eckit::mpi::Operation::Code op, const eckit::mpi::Comm & comm);
+
+    PendingReduction(PendingReduction &&) noexcept;
+    PendingReduction & operator=(PendingReduction &&) noexcept;
+
+    /// \brief Wait for the reduction to complete if it is still in progress.
+    ~PendingReduction();
+
+    /// \brief Return true if the reduction has completed, false otherwise. Does not block.
+    bool test();
+
+    /// \brief Wait for the reduction to complete and return its result.
+    const T & get();
+
+ private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
+
+}  // namespace ioda
+
+#endif  // DISTRIBUTION_PENDINGREDUCTION_H_
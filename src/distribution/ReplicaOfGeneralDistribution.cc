@@ -56,6 +56,28 @@ void ReplicaOfGeneralDistribution::assignRecord(const std::size_t RecNum, const
   }
 }
 
+// -----------------------------------------------------------------------------
+void ReplicaOfGeneralDistribution::assignRecords(
+    const std::vector<std::size_t> & RecNums,
+    const std::vector<std::size_t> & LocNums,
+    const std::vector<eckit::geometry::Point2> & /*points*/,
+    std::vector<bool> & isMine) {
+  masterDist_->flagMyRecords(RecNums, isMine);
+  bool isMasterPatchRecord = false;
+  for (std::size_t i = 0; i < RecNums.size(); ++i) {
+    if (!isMine[i])
+      continue;
+    // Consecutive locations usually belong to the same record, so only look records up
+    // when the record number changes.
+    if (i == 0 || RecNums[i] != RecNums[i - 1]) {
+      myRecords_.insert(RecNums[i]);
+      isMasterPatchRecord = masterPatchRecords_.find(RecNums[i]) != masterPatchRecords_.end();
+    }
+    myGlobalLocs_.push_back(LocNums[i]);
+    isMyPatchObs_.push_back(isMasterPatchRecord);
+  }
+}
+
 // -----------------------------------------------------------------------------
 bool ReplicaOfGeneralDistribution::isMyRecord(std::size_t RecNum) const {
   return myRecords_.find(RecNum) != myRecords_.end();
@@ -24,6 +24,10 @@ class ReplicaOfGeneralDistribution : public Distribution {
 
   void assignRecord(const std::size_t RecNum, const std::size_t LocNum,
                    const eckit::geometry::Point2 & point) override;
+  void assignRecords(const std::vector<std::size_t> & RecNums,
+                     const std::vector<std::size_t> & LocNums,
+                     const std::vector<eckit::geometry::Point2> & points,
+                     std::vector<bool> & isMine) override;
   bool isMyRecord(std::size_t RecNum) const override;
   void computePatchLocs() override;
   void patchObs(std::vector<bool> &) const override;
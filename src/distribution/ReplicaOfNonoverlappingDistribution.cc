@@ -34,6 +34,12 @@ bool ReplicaOfNonoverlappingDistribution::isMyRecord(std::size_t RecNum) const {
   return master_->isMyRecord(RecNum);
 }
 
+// -----------------------------------------------------------------------------
+void ReplicaOfNonoverlappingDistribution::flagMyRecords(const std::vector<std::size_t> & RecNums,
+                                                        std::vector<bool> & isMine) const {
+  master_->flagMyRecords(RecNums, isMine);
+}
+
 // -----------------------------------------------------------------------------
 
 }  // namespace ioda
@@ -34,6 +34,8 @@ class ReplicaOfNonoverlappingDistribution : public NonoverlappingDistribution {
     ~ReplicaOfNonoverlappingDistribution() override;
 
     bool isMyRecord(std::size_t RecNum) const override;
+    void flagMyRecords(const std::vector<std::size_t> & RecNums,
+                       std::vector<bool> & isMine) const override;
 
     std::string name() const override { return "ReplicaOfNonoverlappingDistribution"; }
 
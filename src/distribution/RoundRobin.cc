@@ -52,6 +52,16 @@ bool RoundRobin::isMyRecord(std::size_t RecNum) const {
     return (RecNum % comm_.size() == comm_.rank());
 }
 
+// -----------------------------------------------------------------------------
+void RoundRobin::flagMyRecords(const std::vector<std::size_t> & RecNums,
+                               std::vector<bool> & isMine) const {
+    const std::size_t commSize = comm_.size();
+    const std::size_t commRank = comm_.rank();
+    isMine.resize(RecNums.size());
+    for (std::size_t i = 0; i < RecNums.size(); ++i)
+        isMine[i] = (RecNums[i] % commSize == commRank);
+}
+
 // -----------------------------------------------------------------------------
 
 }  // namespace ioda
@@ -31,6 +31,8 @@ class RoundRobin: public NonoverlappingDistribution {
     ~RoundRobin() override;
 
     bool isMyRecord(std::size_t RecNum) const override;
+    void flagMyRecords(const std::vector<std::size_t> & RecNums,
+                       std::vector<bool> & isMine) const override;
 
     std::string name() const override;
 };
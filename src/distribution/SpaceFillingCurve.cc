@@ -0,0 +1,241 @@
+/*
+ * (C) Copyright 2022 UCAR
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ */
+
+#include "ioda/distribution/SpaceFillingCurve.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <utility>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/mpi/Comm.h"
+#include "ioda/distribution/DistributionFactory.h"
+#include "oops/util/Logger.h"
+
+namespace ioda {
+
+namespace {
+
+/// Rotates and flips a quadrant of the Hilbert curve.
+void rotate(const std::uint64_t n, std::uint64_t & x, std::uint64_t & y,
+            const std::uint64_t rx, const std::uint64_t ry) {
+  if (ry == 0) {
+    if (rx == 1) {
+      x = n - 1 - x;
+      y = n - 1 - y;
+    }
+    std::swap(x, y);
+  }
+}
+
+/// Converts cell coordinates (x, y) on an n x n grid to a position along the Hilbert curve.
+std::uint64_t hilbertIndex(const std::uint64_t n, std::uint64_t x, std::uint64_t y) {
+  std::uint64_t d = 0;
+  for (std::uint64_t s = n / 2; s > 0; s /= 2) {
+    const std::uint64_t rx = (x & s) > 0;
+    const std::uint64_t ry = (y & s) > 0;
+    d += s * s * ((3 * rx) ^ ry);
+    rotate(n, x, y, rx, ry);
+  }
+  return d;
+}
+
+/// Returns the y coordinate of the cell at position d along the Hilbert curve.
+std::uint64_t hilbertRow(const std::uint64_t n, std::uint64_t d) {
+  std::uint64_t x = 0;
+  std::uint64_t y = 0;
+  for (std::uint64_t s = 1; s < n; s *= 2) {
+    const std::uint64_t rx = 1 & (d / 2);
+    const std::uint64_t ry = 1 & (d ^ rx);
+    rotate(s, x, y, rx, ry);
+    x += s * rx;
+    y += s * ry;
+    d /= 4;
+  }
+  return y;
+}
+
+/// Returns the total area of the cells at positions [0, d) along the Hilbert curve on an n x n
+/// grid, where rowAreasBelow[y] is the area of a single column of rows [0, y).
+double curveAreaBefore(const std::uint64_t n, const std::uint64_t d,
+                       const std::vector<double> & rowAreasBelow) {
+  // Split [0, d) into aligned runs of s * s positions, which cover aligned s x s blocks of cells.
+  double area = 0.0;
+  std::uint64_t start = 0;
+  for (std::uint64_t s = n; s > 0; s /= 2) {
+    while (d - start >= s * s) {
+      const std::uint64_t y = hilbertRow(n, start) / s * s;
+      area += s * (rowAreasBelow[y + s] - rowAreasBelow[y]);
+      start += s * s;
+    }
+  }
+  return area;
+}
+
+const double deg2rad = M_PI / 180.0;
+
+}  // namespace
+
+// -----------------------------------------------------------------------------
+static DistributionMaker<SpaceFillingCurve> maker("SpaceFillingCurve");
+
+// -----------------------------------------------------------------------------
+SpaceFillingCurve::SpaceFillingCurve(const eckit::mpi::Comm & Comm,
+                                     const Parameters_ & params)
+                                     : NonoverlappingDistribution(Comm) {
+  const int order = params.order;
+  if (order < 1 || order > 13) {
+    throw eckit::BadParameter("SpaceFillingCurve: curve order must be between 1 and 13", Here());
+  }
+  numCells_ = std::uint64_t(1) << order;
+
+  oops::Log::trace() << "SpaceFillingCurve constructed" << std::endl;
+}
+
+// -----------------------------------------------------------------------------
+SpaceFillingCurve::~SpaceFillingCurve() {
+  oops::Log::trace() << "SpaceFillingCurve destructed" << std::endl;
+}
+
+// -----------------------------------------------------------------------------
+std::string SpaceFillingCurve::name() const {
+  return "SpaceFillingCurve";
+}
+
+// -----------------------------------------------------------------------------
+std::uint64_t SpaceFillingCurve::curveIndex(const eckit::geometry::Point2 & point) const {
+  if (!std::isfinite(point[0]) || !std::isfinite(point[1]))
+    return 0;
+  double lon = std::fmod(point[0] + 180.0, 360.0);
+  if (lon < 0.0)
+    lon += 360.0;
+  const double lat = std::min(std::max(point[1] + 90.0, 0.0), 180.0);
+
+  const std::uint64_t x = std::min(numCells_ - 1,
+                                   static_cast<std::uint64_t>(lon / 360.0 * numCells_));
+  const std::uint64_t y = std::min(numCells_ - 1,
+                                   static_cast<std::uint64_t>(lat / 180.0 * numCells_));
+  return hilbertIndex(numCells_, x, y);
+}
+
+// -----------------------------------------------------------------------------
+void SpaceFillingCurve::setRanges(const std::vector<std::uint64_t> & firstIndices) {
+  const std::size_t myRank = comm_.rank();
+  myFirstIndex_ = firstIndices[myRank];
+  myEndIndex_ = firstIndices[myRank + 1];
+  rangesSet_ = true;
+}
+
+// -----------------------------------------------------------------------------
+void SpaceFillingCurve::setRangesFromSample(
+    const std::vector<eckit::geometry::Point2> & points) {
+  std::vector<std::uint64_t> sample;
+  sample.reserve(points.size());
+  for (const eckit::geometry::Point2 & point : points)
+    if (std::isfinite(point[0]) && std::isfinite(point[1]))
+      sample.push_back(curveIndex(point));
+  if (sample.empty()) {
+    setEqualAreaRanges();
+    return;
+  }
+  std::sort(sample.begin(), sample.end());
+
+  // Rank r starts at the curve position of the (r * n / numRanks)-th sampled location, so each
+  // rank gets the same number of sampled locations (up to ties between locations sharing a cell).
+  const std::size_t numRanks = comm_.size();
+  std::vector<std::uint64_t> firstIndices(numRanks + 1);
+  firstIndices[0] = 0;
+  for (std::size_t r = 1; r < numRanks; ++r)
+    firstIndices[r] = sample[r * sample.size() / numRanks];
+  firstIndices[numRanks] = numCells_ * numCells_;
+  setRanges(firstIndices);
+}
+
+// -----------------------------------------------------------------------------
+void SpaceFillingCurve::setEqualAreaRanges() {
+  // Area of the rows of cells below each row of the grid (up to a constant factor).
+  std::vector<double> rowAreasBelow(numCells_ + 1);
+  for (std::uint64_t y = 0; y <= numCells_; ++y)
+    rowAreasBelow[y] = std::sin((-90.0 + 180.0 * y / numCells_) * deg2rad) + 1.0;
+  const double totalArea = numCells_ * rowAreasBelow[numCells_];
+
+  // Each cell goes to the rank whose share of the total area contains the midpoint of the cell.
+  // The owners are non-decreasing along the curve, so the first cell of each rank can be found
+  // by a binary search.
+  const std::size_t numRanks = comm_.size();
+  const std::uint64_t numCurveCells = numCells_ * numCells_;
+  std::vector<std::uint64_t> firstIndices(numRanks + 1);
+  firstIndices[0] = 0;
+  for (std::size_t r = 1; r < numRanks; ++r) {
+    const double areaBeforeRank = totalArea * r / numRanks;
+    std::uint64_t lo = firstIndices[r - 1];
+    std::uint64_t hi = numCurveCells;
+    while (lo < hi) {
+      const std::uint64_t d = lo + (hi - lo) / 2;
+      const std::uint64_t y = hilbertRow(numCells_, d);
+      const double cellArea = rowAreasBelow[y + 1] - rowAreasBelow[y];
+      if (curveAreaBefore(numCells_, d, rowAreasBelow) + 0.5 * cellArea < areaBeforeRank)
+        lo = d + 1;
+      else
+        hi = d;
+    }
+    firstIndices[r] = lo;
+  }
+  firstIndices[numRanks] = numCurveCells;
+  setRanges(firstIndices);
+}
+
+// -----------------------------------------------------------------------------
+void SpaceFillingCurve::assignRecordImpl(const std::size_t RecNum,
+                                         const eckit::geometry::Point2 & point) {
+  if (RecNum >= recordStates_.size())
+    recordStates_.resize(RecNum + 1, unassigned);
+
+  if (recordStates_[RecNum] == unassigned) {
+    const std::uint64_t d = curveIndex(point);
+    recordStates_[RecNum] = (d >= myFirstIndex_ && d < myEndIndex_) ? mine : notMine;
+  }
+}
+
+// -----------------------------------------------------------------------------
+void SpaceFillingCurve::assignRecord(const std::size_t RecNum, const std::size_t LocNum,
+                                     const eckit::geometry::Point2 & point) {
+  if (!rangesSet_)
+    setEqualAreaRanges();
+  assignRecordImpl(RecNum, point);
+  NonoverlappingDistribution::assignRecord(RecNum, LocNum, point);
+}
+
+// -----------------------------------------------------------------------------
+void SpaceFillingCurve::assignRecords(const std::vector<std::size_t> & RecNums,
+                                      const std::vector<std::size_t> & LocNums,
+                                      const std::vector<eckit::geometry::Point2> & points,
+                                      std::vector<bool> & isMine) {
+  if (!rangesSet_ && !points.empty())
+    setRangesFromSample(points);
+  for (std::size_t i = 0; i < RecNums.size(); ++i)
+    assignRecordImpl(RecNums[i], points[i]);
+  NonoverlappingDistribution::assignRecords(RecNums, LocNums, points, isMine);
+}
+
+// -----------------------------------------------------------------------------
+bool SpaceFillingCurve::isMyRecord(std::size_t RecNum) const {
+  return RecNum < recordStates_.size() && recordStates_[RecNum] == mine;
+}
+
+// -----------------------------------------------------------------------------
+void SpaceFillingCurve::flagMyRecords(const std::vector<std::size_t> & RecNums,
+                                      std::vector<bool> & isMine) const {
+  isMine.resize(RecNums.size());
+  for (std::size_t i = 0; i < RecNums.size(); ++i)
+    isMine[i] = RecNums[i] < recordStates_.size() && recordStates_[RecNums[i]] == mine;
+}
+
+// -----------------------------------------------------------------------------
+
+}  // namespace ioda
@@ -0,0 +1,105 @@
+/*
+ * (C) Copyright 2022 UCAR
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ */
+
+#ifndef DISTRIBUTION_SPACEFILLINGCURVE_H_
+#define DISTRIBUTION_SPACEFILLINGCURVE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "oops/util/parameters/Parameter.h"
+
+#include "ioda/distribution/NonoverlappingDistribution.h"
+#include "ioda/distribution/DistributionParametersBase.h"
+
+namespace ioda {
+
+class SpaceFillingCurveDistributionParameters : public DistributionParametersBase {
+  OOPS_CONCRETE_PARAMETERS(SpaceFillingCurveDistributionParameters, DistributionParametersBase)
+
+ public:
+  /// The longitude-latitude plane is divided into 2^order x 2^order cells, which are
+  /// traversed by the Hilbert curve.
+  oops::Parameter<int> order{"curve order", 10, this};
+};
+
+// ---------------------------------------------------------------------
+/*!
+ * \brief Space-filling curve distribution
+ *
+ * \details This class implements a geographically compact, non-overlapping distribution
+ *          that doesn't need an Atlas mesh. Each location is mapped to a cell of a regular
+ *          longitude-latitude grid and the cells are ordered along a Hilbert curve. The curve
+ *          is split into contiguous ranges, one per process element, and each record is
+ *          assigned to the process element owning the range containing its first location.
+ *
+ *          The ranges are chosen so that each process element holds the same number of the
+ *          locations passed to the first non-empty assignRecords() call (normally those of the
+ *          first frame of the observation file), so that clustered or regional datasets are
+ *          balanced too. Every process element sees the same sequence of calls, so all of them
+ *          compute the same ranges without any communication. If records are assigned one at a
+ *          time with assignRecord() instead, no sample is available and the curve is split
+ *          into ranges of equal area.
+ */
+class SpaceFillingCurve: public NonoverlappingDistribution {
+ public:
+    typedef SpaceFillingCurveDistributionParameters Parameters_;
+
+    SpaceFillingCurve(const eckit::mpi::Comm & Comm,
+                      const Parameters_ &);
+    ~SpaceFillingCurve() override;
+
+    void assignRecord(const std::size_t RecNum, const std::size_t LocNum,
+                      const eckit::geometry::Point2 & point) override;
+    void assignRecords(const std::vector<std::size_t> & RecNums,
+                       const std::vector<std::size_t> & LocNums,
+                       const std::vector<eckit::geometry::Point2> & points,
+                       std::vector<bool> & isMine) override;
+
+    bool isMyRecord(std::size_t RecNum) const override;
+    void flagMyRecords(const std::vector<std::size_t> & RecNums,
+                       std::vector<bool> & isMine) const override;
+
+    std::string name() const override;
+
+ private:
+    /// Returns the position along the Hilbert curve of the cell containing `point`.
+    std::uint64_t curveIndex(const eckit::geometry::Point2 & point) const;
+
+    /// If record `RecNum` hasn't been assigned yet, assigns it to the process element owning
+    /// the curve range containing `point`.
+    void assignRecordImpl(std::size_t RecNum, const eckit::geometry::Point2 & point);
+
+    /// Sets the curve range owned by this process element. `firstIndices[r]` is the first
+    /// curve position owned by rank r; the last element is the length of the curve.
+    void setRanges(const std::vector<std::uint64_t> & firstIndices);
+
+    /// Splits the curve so that each process element owns the same number of `points`.
+    void setRangesFromSample(const std::vector<eckit::geometry::Point2> & points);
+
+    /// Splits the curve into ranges of equal area.
+    void setEqualAreaRanges();
+
+    /// State of each record, indexed by record number.
+    enum RecordState : unsigned char { unassigned, mine, notMine };
+    std::vector<RecordState> recordStates_;
+
+    /// Number of cells along each axis.
+    std::uint64_t numCells_;
+
+    /// Curve range owned by this process element: [myFirstIndex_, myEndIndex_).
+    std::uint64_t myFirstIndex_ = 0;
+    std::uint64_t myEndIndex_ = 0;
+
+    /// True once the curve ranges have been set.
+    bool rangesSet_ = false;
+};
+
+}  // namespace ioda
+
+#endif  // DISTRIBUTION_SPACEFILLINGCURVE_H_
@@ -174,6 +174,12 @@ private:
   /// be set to nullptr to indicate that.
   eckit::mpi::Comm *comm_pool_;
 
+  /// \brief name of the MPI communicator group for this pool
+  std::string pool_comm_name_;
+
+  /// \brief name of the MPI communicator group for the processes not in this pool
+  std::string non_pool_comm_name_;
+
   /// \brief rank in MPI communicator group for this pool
   int rank_pool_;
 
@@ -235,29 +241,8 @@ private:
   /// to the nlocs dimension when writing to a single output file.
   void collectSingleFileInfo();
 
-  /// \brief create file names for the fixed length string workaround
-  /// \details The workaround entails moving the newly written file name to a temporary
-  /// file and then copying the temp file back to the intended file name while changing
-  /// the fixed length strings to variable length strings.
-  /// \param finalFileName final (intended) output file name
-  /// \param tempFileName temporary output file name
-  void workaroundGenFileNames(std::string & finalFileName, std::string & tempFileName);
-
-  /// \brief create file names for the fixed length string workaround
-  void workaroundFixToVarLenStrings(const std::string & finalFileName,
-                                    const std::string & tempFileName);
-};
-
-class WorkaroundReaderParameters : public oops::Parameters {
-  OOPS_CONCRETE_PARAMETERS(WorkaroundReaderParameters, Parameters)
- public:
-  oops::RequiredParameter<Engines::ReaderParametersWrapper> engine{"engine", this};
-};
-
-class WorkaroundWriterParameters : public oops::Parameters {
-  OOPS_CONCRETE_PARAMETERS(WorkaroundWriterParameters, Parameters)
- public:
-  oops::RequiredParameter<Engines::WriterParametersWrapper> engine{"engine", this};
+  /// \brief return the name of the output file written in parallel io mode
+  std::string parallelOutputFileName() const;
 };
 
 }  // namespace ioda
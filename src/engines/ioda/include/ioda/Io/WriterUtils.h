@@ -12,6 +12,7 @@
 #include <gsl/gsl-lite.hpp>
 #include <memory>
 #include <set>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -21,12 +22,38 @@ namespace ioda {
     class Group;
     class IoPool;
 
+/// @brief String variable held back from a parallel write
+/// @details String variables are written as variable length strings, which HDF5 cannot
+/// write in parallel io mode. In that mode their values are gathered onto io pool rank 0,
+/// which writes them with ioWriteDeferredStrings after the parallel writer has closed the file.
+struct DeferredStringVariable {
+    /// variable name
+    std::string name;
+    /// size of the nlocs dimension in the file, or -1 if the variable does not use nlocs
+    int adjustNlocs;
+    /// names of the dimension scales attached to the variable
+    std::vector<std::string> dimNames;
+    /// variable values (only held on io pool rank 0)
+    std::vector<std::string> values;
+};
+
 /// @brief Transfer group contents from in memory group to a file group using an io pool
 /// @param ioPool ioda IoPool object
 /// @param memGroup is the source in memory group
 /// @param fileGroup is the destination file group
 /// @param isParallelIo true if writing the output file in parallel IO mode
+/// @param deferredStringVars filled with the string variables that still need to be written
+/// with ioWriteDeferredStrings (parallel IO mode only, empty otherwise)
 IODA_DL void ioWriteGroup(const ioda::IoPool & ioPool, const ioda::Group& memGroup,
-                          ioda::Group& fileGroup, const bool isParallelIo);
+                          ioda::Group& fileGroup, const bool isParallelIo,
+                          std::vector<DeferredStringVariable> & deferredStringVars);
+
+/// @brief Create and write the string variables held back by ioWriteGroup
+/// @details Called on io pool rank 0 only, with the output file opened in serial mode.
+/// @param memGroup is the source in memory group
+/// @param fileGroup is the destination file group
+/// @param deferredStringVars string variables returned by ioWriteGroup
+IODA_DL void ioWriteDeferredStrings(const ioda::Group& memGroup, ioda::Group& fileGroup,
+                                    const std::vector<DeferredStringVariable> & deferredStringVars);
 
 }  // namespace ioda
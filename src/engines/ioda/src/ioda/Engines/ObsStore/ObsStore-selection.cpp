@@ -137,7 +137,7 @@ void genDimSelects(const std::vector<Selection::SingleSelection>& actions,
     for (std::size_t i = 0; i < actions[iact].dimension_indices_starts_.size(); ++i) {
       std::size_t idx = actions[iact].dimension_indices_starts_[i];
       if (haveCounts) {
-        for (std::size_t j = 0; j < actions[iact].dimension_indices_counts_.size(); ++j) {
+        for (std::size_t j = 0; j < actions[iact].dimension_indices_counts_[i]; ++j) {
           dim_indices.insert(idx + j);
         }
       } else {
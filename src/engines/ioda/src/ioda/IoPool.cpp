@@ -5,15 +5,12 @@
  * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
  */
 
-#include <cstdio>
 #include <memory>
 #include <mpi.h>
 #include <numeric>
 #include <sstream>
+#include <string>
 
-#include "eckit/config/LocalConfiguration.h"
-
-#include "ioda/Copying.h"
 #include "ioda/Engines/EngineUtils.h"
 #include "ioda/Engines/HH.h"
 #include "ioda/Exception.h"
@@ -191,12 +188,12 @@ void IoPool::createIoPool(IoPoolGroupMap & rankGrouping) {
     }
 
     if (myColor == nonPoolColor) {
-        comm_all_.split(myColor, nonPoolCommName);
+        comm_all_.split(myColor, non_pool_comm_name_.c_str());
         comm_pool_ = nullptr;  // mark that this rank does not belong to an io pool
         rank_pool_ = -1;
         size_pool_ = -1;
     } else {
-        comm_pool_ = &(comm_all_.split(myColor, poolCommName));
+        comm_pool_ = &(comm_all_.split(myColor, pool_comm_name_.c_str()));
         rank_pool_ = comm_pool_->rank();
         size_pool_ = comm_pool_->size();
     }
@@ -258,6 +255,14 @@ IoPool::IoPool(const oops::Parameter<IoPoolParameters> & ioPoolParams,
                      comm_time_(commTime), rank_time_(commTime.rank()),
                      size_time_(commTime.size()), win_start_(winStart), win_end_(winEnd),
                      nlocs_(nlocs), total_nlocs_(0), global_nlocs_(0) {
+    // Name the split communicator groups after this instance so that several io pools
+    // (eg, from asynchronous saves of different obs spaces) can exist at the same time.
+    // The names are only keys in the eckit communicator registry of this process.
+    static int poolInstance = 0;
+    const std::string nameSuffix = std::to_string(poolInstance++);
+    pool_comm_name_ = poolCommName + nameSuffix;
+    non_pool_comm_name_ = nonPoolCommName + nameSuffix;
+
     // For now, the target pool size is simply the minumum of the specified (or default) max
     // pool size and the size of the comm_all_ communicator group.
     setTargetPoolSize();
@@ -316,11 +321,11 @@ IoPool::~IoPool() = default;
 //--------------------------------------------------------------------------------------
 void IoPool::save(const Group & srcGroup) {
     Group fileGroup;
+    std::unique_ptr<Engines::WriterBase> writerEngine;
     if (comm_pool_ != nullptr) {
         Engines::WriterCreationParameters createParams(*comm_pool_, comm_time_,
                                           create_multiple_files_, is_parallel_io_);
-        std::unique_ptr<Engines::WriterBase> writerEngine =
-            Engines::WriterFactory::create(writer_params_, createParams);
+        writerEngine = Engines::WriterFactory::create(writer_params_, createParams);
 
         fileGroup = writerEngine->getObsGroup();
 
@@ -331,137 +336,49 @@ void IoPool::save(const Group & srcGroup) {
     }
 
     // Copy the ObsSpace ObsGroup to the output file Group.
-    ioWriteGroup(*this, srcGroup, fileGroup, is_parallel_io_);
+    std::vector<DeferredStringVariable> deferredStringVars;
+    ioWriteGroup(*this, srcGroup, fileGroup, is_parallel_io_, deferredStringVars);
+
+    // In parallel io mode the string variables have been gathered onto io pool rank 0.
+    // Close the file, then have that rank reopen it in serial mode and write them as
+    // variable length strings.
+    if ((comm_pool_ != nullptr) && is_parallel_io_) {
+        fileGroup = Group();
+        writerEngine.reset();
+        if (rank_pool_ == 0) {
+            Engines::BackendCreationParameters backendParams;
+            backendParams.fileName = parallelOutputFileName();
+            backendParams.action = Engines::BackendFileActions::Open;
+            backendParams.openMode = Engines::BackendOpenModes::Read_Write;
+            Group serialFileGroup =
+                Engines::constructBackend(Engines::BackendNames::Hdf5File, backendParams);
+            ioWriteDeferredStrings(srcGroup, serialFileGroup, deferredStringVars);
+        }
+        // Make sure the file is complete before any rank moves on
+        comm_pool_->barrier();
+    }
 }
 
-void IoPool::workaroundGenFileNames(std::string & finalFileName, std::string & tempFileName) {
-    tempFileName = writer_params_.value().fileName;
-    finalFileName = tempFileName;
-
-    // Append "_flenstr" (fixed length strings) to the temp file name, then uniquify
-    // in the same manner as the writer backend.
-    std::size_t found = tempFileName.find_last_of(".");
-    if (found == std::string::npos)
-        found = tempFileName.length();
-    tempFileName.insert(found, "_flenstr");
-
-    std::size_t mpiRank = comm_pool_->rank();
+//--------------------------------------------------------------------------------------
+std::string IoPool::parallelOutputFileName() const {
+    // Uniquify the file name in the same manner as the writer backend does in parallel
+    // io mode, where the suffix part related to the mpi rank is always zero.
     int mpiTimeRank = -1; // a value of -1 tells uniquifyFileName to skip this value
     if (comm_time_.size() > 1) {
         mpiTimeRank = comm_time_.rank();
     }
-    if (create_multiple_files_) {
-        // Tag on the rank number to the output file name to avoid collisions.
-        // Don't use the time communicator rank number in the suffix if the size of
-        // the time communicator is 1.
-        tempFileName = uniquifyFileName(tempFileName, mpiRank, mpiTimeRank);
-        finalFileName = uniquifyFileName(finalFileName, mpiRank, mpiTimeRank);
-    } else {
-        // TODO(srh) With the upcoming release (Sep 2022) we need to keep the uniquified
-        // file name in order to prevent trashing downstream tools. We can get rid of
-        // the file suffix after the release.
-        // If we got to here, we either have just one process in io pool, or we
-        // are going to write out the file in parallel mode. In either case, we want
-        // the suffix part related to mpiRank to always be zero.
-        tempFileName = uniquifyFileName(tempFileName, 0, mpiTimeRank);
-        finalFileName = uniquifyFileName(finalFileName, 0, mpiTimeRank);
-    }
-}
-
-void IoPool::workaroundFixToVarLenStrings(const std::string & finalFileName,
-                                          const std::string & tempFileName) {
-    oops::Log::debug() << "IoPool::finalize: applying flen to vlen strings workaround: "
-                       << tempFileName << " -> "
-                       << finalFileName << std::endl;
-
-    // Rename the output file, then copy back to the original name while changing the
-    // strings back to variable length strings.
-    if (std::rename(finalFileName.c_str(), tempFileName.c_str()) != 0) {
-        throw Exception("Unable to rename output file.", ioda_Here());
-    }
-
-    // Create backends for reading the temp file and writing the final file.
-    // Reader backend
-    eckit::LocalConfiguration readerConfig;
-    eckit::LocalConfiguration readerSubConfig;
-    readerSubConfig.set("type", "H5File");
-    readerSubConfig.set("obsfile", tempFileName);
-    readerConfig.set("engine", readerSubConfig);
-    oops::Log::debug() << "Workaround reader config: " << readerConfig << std::endl;
-
-    WorkaroundReaderParameters readerParams;
-    readerParams.validateAndDeserialize(readerConfig);
-    std::unique_ptr<Engines::ReaderBase> readerEngine = Engines::ReaderFactory::create(
-          readerParams.engine.value().engineParameters, win_start_, win_end_,
-          *comm_pool_, comm_time_, {});
-
-    // Writer backend
-    WorkaroundWriterParameters writerParams;
-    eckit::LocalConfiguration writerConfig;
-    eckit::LocalConfiguration writerSubConfig;
-    writerSubConfig.set("type", "H5File");
-    writerSubConfig.set("obsfile", writer_params_.value().fileName);
-    writerConfig.set("engine", writerSubConfig);
-    oops::Log::debug() << "Workaround writer config: " << writerConfig << std::endl;
-    std::unique_ptr<Engines::WriterBase> workaroundWriter;
-
-    // We want each rank to write its own corresponding file, and that can be accomplished
-    // in telling the writer that we are to create multiple files and not use the parallel
-    // io mode.
-    writerParams.validateAndDeserialize(writerConfig);
-    bool createMultipleFiles = true;
-    bool isParallel = false;
-    Engines::WriterCreationParameters createParams(*comm_pool_, comm_time_,
-                                      createMultipleFiles, isParallel);
-    std::unique_ptr<Engines::WriterBase> writerEngine = Engines::WriterFactory::create(
-          writerParams.engine.value().engineParameters, createParams);
-
-    // Copy the contents from the temp file to the final file.
-    Group readerTopGroup = readerEngine->getObsGroup();
-    Group writerTopGroup = writerEngine->getObsGroup();
-    copyGroup(readerTopGroup, writerTopGroup);
-
-    // If we made it to here, we successfully copied the file, so we can remove
-    // the temporary file.
-    if (std::remove(tempFileName.c_str()) != 0) {
-        oops::Log::info() << "WARNING: Unable to remove temporary output file: "
-                          << tempFileName << std::endl;
-    }
+    return uniquifyFileName(writer_params_.value().fileName, 0, mpiTimeRank);
 }
 
 //--------------------------------------------------------------------------------------
 void IoPool::finalize() {
-    // TODO(srh) Workaround until we get fixed length string support in the netcdf-c
-    // library. This is expected to be available in the 4.9.1 release of netcdf-c.
-    // For now move the file with fixed length strings to a temporary
-    // file (obsdataout.obsfile spec with "_flenstr" appended to the filename) and
-    // then copy that file to the intended output file while changing the fixed
-    // length strings to variable length strings.
-    if (comm_pool_ != nullptr) {
-        // Create the temp file name, move the output file to the temp file name,
-        // then copy the file to the intended file name.
-        std::string tempFileName;
-        std::string finalFileName;
-        workaroundGenFileNames(finalFileName, tempFileName);
-
-        // If the output file was created using parallel io, then we only need rank 0
-        // to do the rename, copy workaround.
-        if (is_parallel_io_) {
-            if (comm_pool_->rank() == 0) {
-                workaroundFixToVarLenStrings(finalFileName, tempFileName);
-            }
-        } else {
-            workaroundFixToVarLenStrings(finalFileName, tempFileName);
-        }
-    }
-
     // At this point there are two split communicator groups: one for the io pool and the
     // other for the processes not included in the io pool.
-    if (eckit::mpi::hasComm(poolCommName)) {
-        eckit::mpi::deleteComm(poolCommName);
+    if (eckit::mpi::hasComm(pool_comm_name_.c_str())) {
+        eckit::mpi::deleteComm(pool_comm_name_.c_str());
     }
-    if (eckit::mpi::hasComm(nonPoolCommName)) {
-        eckit::mpi::deleteComm(nonPoolCommName);
+    if (eckit::mpi::hasComm(non_pool_comm_name_.c_str())) {
+        eckit::mpi::deleteComm(non_pool_comm_name_.c_str());
     }
 }
 
@@ -9,9 +9,15 @@
 
 #include "ioda/Io/WriterUtils.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <limits>
 #include <numeric>
+#include <string>
 #include <unordered_set>
+#include <utility>
 
 #include "eckit/mpi/Comm.h"
 
@@ -27,8 +33,13 @@
 
 namespace ioda {
 
-constexpr int mpiTagBase = 20000;
-constexpr int varNumTagFactor = 100;
+// MPI tags for the transfers between the io pool ranks and their assigned ranks. Messages
+// between a given pair of ranks are matched in order, so the tags only need to tell apart
+// the transfers, not the ranks taking part in them.
+constexpr int packedTransferTag = 20000;
+constexpr int stringOffsetsTag = 20001;
+constexpr int stringBlobTag = 20002;
+constexpr int stringGatherTagBase = 30000;
 
 // private functions
 Selection createBlockSelection(const std::vector<Dimensions_t> & varShape,
@@ -72,20 +83,25 @@ void transferVarData(const IoPool & ioPool, const Variable & srcVar,
     }
 }
 
+// Returns the number of elements from the product of the second and higher dimensions
+// sizes of srcVar.
+Dimensions_t calcDimFactor(const Variable & srcVar) {
+    std::vector<Dimensions_t> srcDims = srcVar.getDimensions().dimsCur;
+    Dimensions_t dimFactor = 1;
+    if (srcDims.size() > 1) {
+         dimFactor *= std::accumulate(srcDims.begin() + 1, srcDims.end(), 1, 
+            std::multiplies<Dimensions_t>());
+    }
+    return dimFactor;
+}
+
 void calcVarStartsCounts(const IoPool & ioPool, const Variable & srcVar,
                          std::vector<std::size_t> & varStarts,
                          std::vector<std::size_t> & varCounts,
                          Dimensions_t & dimFactor) {
     varStarts.clear();
     varCounts.clear();
-    std::vector<Dimensions_t> srcDims = srcVar.getDimensions().dimsCur;
-    // dimFactor holds the number of elements from the product of the second and
-    // higher dimensions sizes.
-    dimFactor = 1;
-    if (srcDims.size() > 1) {
-         dimFactor *= std::accumulate(srcDims.begin() + 1, srcDims.end(), 1, 
-            std::multiplies<Dimensions_t>());
-    }
+    dimFactor = calcDimFactor(srcVar);
     std::size_t start;
     if (ioPool.rank_pool() >= 0) {
         // For ranks in the pool, we are placing the data from the non-pool ranks into
@@ -112,148 +128,318 @@ void calcVarStartsCounts(const IoPool & ioPool, const Variable & srcVar,
     }
 }
 
-template <typename VarType>
-void transferVarDataMPI(const IoPool & ioPool, const Variable & srcVar,
-                        const std::string & varName, int varNumber,
-                        const std::vector<std::size_t> & varStarts,
-                        const std::vector<std::size_t> & varCounts,
-                        Dimensions_t dimFactor, Group & dest,
-                        const bool isParallelIo, const std::size_t strLen) {
+// Numeric variable dimensioned by nlocs, transferred with the packed transfer
+struct PackedVariable {
+    std::string name;
+    Variable var;
+    Dimensions_t dimFactor;
+    std::size_t elementSize;
+};
+
+// Throw if a message is too long to be described by an int count of bytes.
+void checkMessageSize(const std::size_t numBytes) {
+    if (numBytes > static_cast<std::size_t>(std::numeric_limits<int>::max())) {
+        throw Exception("Packed io pool transfer exceeds the maximum MPI message size",
+                        ioda_Here());
+    }
+}
 
+// Append the bytes of the data of a numeric variable to a packed buffer.
+template <typename VarType>
+void appendVarBytes(const Variable & srcVar, std::vector<char> & buffer) {
     std::vector<VarType> varData;
     srcVar.read<VarType>(varData);
-    if (ioPool.rank_pool() >= 0) {
-        // Resize varData according to total nlocs.
-        Dimensions_t numElements = ioPool.total_nlocs() * dimFactor;
-        varData.resize(numElements);
+    const char * varBytes = reinterpret_cast<const char *>(varData.data());
+    buffer.insert(buffer.end(), varBytes, varBytes + varData.size() * sizeof(VarType));
+}
 
-        // Walk through the rank assignments and issue receive commands.
+template <>
+void appendVarBytes<std::string>(const Variable &, std::vector<char> &) {
+    throw Exception("String variables are not part of the packed io pool transfer",
+                    ioda_Here());
+}
+
+// Transfer the data of the numeric variables dimensioned by nlocs from the non io pool ranks
+// to their io pool rank, with one message per non io pool rank. Each message starts with a
+// descriptor table holding the number of bytes of each variable, followed by the data of
+// the variables in the order of packedVars. Returns the received messages (one per rank
+// assignment) on io pool ranks, and an empty vector on the other ranks.
+std::vector<std::vector<char>> transferPackedVars(const IoPool & ioPool,
+                                                  const std::vector<PackedVariable> & packedVars) {
+    std::vector<std::vector<char>> buffers;
+    if (packedVars.empty()) {
+        return buffers;
+    }
+    const std::size_t tableBytes = packedVars.size() * sizeof(std::uint64_t);
+    if (ioPool.rank_pool() >= 0) {
+        buffers.resize(ioPool.rank_assignment().size());
         std::vector<eckit::mpi::Request> recvRequests(ioPool.rank_assignment().size());
         for (std::size_t i = 0; i < ioPool.rank_assignment().size(); ++i) {
             int fromRank = ioPool.rank_assignment()[i].first;
-            int tag = mpiTagBase + (varNumber * varNumTagFactor) + fromRank;
+            std::size_t numBytes = tableBytes;
+            for (auto & packedVar : packedVars) {
+                numBytes += ioPool.rank_assignment()[i].second * packedVar.dimFactor *
+                            packedVar.elementSize;
+            }
+            checkMessageSize(numBytes);
+            buffers[i].resize(numBytes);
             recvRequests[i] = ioPool.comm_all().iReceive(
-                varData.data() + varStarts[i], varCounts[i], fromRank, tag);
+                buffers[i].data(), numBytes, fromRank, packedTransferTag);
         }
         ioPool.comm_all().waitAll(recvRequests);
-        Variable destVar = dest.vars.open(varName);
-        if (isParallelIo) {
-            Selection memSelect = createBlockSelection(destVar.getDimensions().dimsCur,
-                                  0, ioPool.total_nlocs(), false);
-            Selection fileSelect = createBlockSelection(destVar.getDimensions().dimsCur,
-                                   ioPool.nlocs_start(), ioPool.total_nlocs(), true);
-            destVar.parallelWrite<VarType>(varData, memSelect, fileSelect);
-        } else {
-            destVar.write<VarType>(varData);
+
+        // Check the descriptor tables against the sizes expected from the rank assignments.
+        for (std::size_t i = 0; i < buffers.size(); ++i) {
+            for (std::size_t j = 0; j < packedVars.size(); ++j) {
+                std::uint64_t numVarBytes;
+                std::memcpy(&numVarBytes, buffers[i].data() + j * sizeof(std::uint64_t),
+                            sizeof(std::uint64_t));
+                if (numVarBytes != ioPool.rank_assignment()[i].second *
+                                   packedVars[j].dimFactor * packedVars[j].elementSize) {
+                    throw Exception("Unexpected size of variable " + packedVars[j].name +
+                                    " in packed io pool transfer", ioda_Here());
+                }
+            }
         }
     } else {
-        // Non io pool ranks. These ranks will always read their data from src, and send it as
-        // is to their assigned io pool rank.
+        // Non io pool ranks. Pack the data of all of the variables, then send the buffer
+        // to the assigned io pool rank.
+        std::vector<char> buffer(tableBytes);
+        for (std::size_t j = 0; j < packedVars.size(); ++j) {
+            const std::size_t varStart = buffer.size();
+            VarUtils::forAnySupportedVariableType(
+                packedVars[j].var,
+                [&](auto typeDiscriminator) {
+                    typedef decltype(typeDiscriminator) T;
+                    appendVarBytes<T>(packedVars[j].var, buffer);
+                },
+                VarUtils::ThrowIfVariableIsOfUnsupportedType(packedVars[j].name));
+            const std::uint64_t numVarBytes = buffer.size() - varStart;
+            std::memcpy(buffer.data() + j * sizeof(std::uint64_t), &numVarBytes,
+                        sizeof(std::uint64_t));
+        }
+        checkMessageSize(buffer.size());
         std::vector<eckit::mpi::Request> sendRequests(ioPool.rank_assignment().size());
         for (std::size_t i = 0; i < ioPool.rank_assignment().size(); ++i) {
             int toRank = ioPool.rank_assignment()[i].first;
-            int tag = mpiTagBase + (varNumber * varNumTagFactor) + ioPool.rank_all();
             sendRequests[i] = ioPool.comm_all().iSend(
-                varData.data() + varStarts[i], varCounts[i], toRank, tag);
+                buffer.data(), buffer.size(), toRank, packedTransferTag);
         }
         ioPool.comm_all().waitAll(sendRequests);
     }
+    return buffers;
 }
 
-// template specialization for std::string
-template <>
-void transferVarDataMPI<std::string>(const IoPool & ioPool, const Variable & srcVar,
-                        const std::string & varName, const int varNumber,
-                        const std::vector<std::size_t> & varStarts,
-                        const std::vector<std::size_t> & varCounts,
-                        const Dimensions_t dimFactor, Group & dest,
-                        const bool isParallelIo, const std::size_t strLen) {
-    int maxStringLength = strLen + 1;
-
-    std::vector<std::string> varData;
-    srcVar.read<std::string>(varData);
+// On io pool ranks, assemble the data of a numeric variable dimensioned by nlocs from the
+// data on this rank and the messages of the packed transfer, then write it to the file.
+// packedOffsets holds the position of the variable data in each message and is advanced
+// past it.
+template <typename VarType>
+void writePackedVar(const IoPool & ioPool, const Variable & srcVar,
+                    const std::string & varName,
+                    const std::vector<std::size_t> & varStarts,
+                    const std::vector<std::size_t> & varCounts,
+                    const Dimensions_t dimFactor,
+                    const std::vector<std::vector<char>> & packedBuffers,
+                    std::vector<std::size_t> & packedOffsets,
+                    Group & dest, const bool isParallelIo) {
     if (ioPool.rank_pool() >= 0) {
+        std::vector<VarType> varData;
+        srcVar.read<VarType>(varData);
         // Resize varData according to total nlocs.
         Dimensions_t numElements = ioPool.total_nlocs() * dimFactor;
         varData.resize(numElements);
-
-        // Walk through the rank assignments and issue receive commands.
-        for (std::size_t i = 0; i < ioPool.rank_assignment().size(); ++i) {
-            int fromRank = ioPool.rank_assignment()[i].first;
-            int tag = mpiTagBase + (varNumber * varNumTagFactor) + fromRank;
-            std::vector<char> strBuffer(varCounts[i] * maxStringLength, '\0');
-            ioPool.comm_all().receive(strBuffer.data(), strBuffer.size(), fromRank, tag);
-            for (std::size_t j = 0; j < varCounts[i]; ++j) {
-                std::size_t offset = j * maxStringLength;
-                auto strEnd = std::find(strBuffer.begin() + offset, strBuffer.end(), '\0');
-                if (strEnd == strBuffer.end()) {
-                    throw Exception("End of string not found during MPI transfer", ioda_Here());
-                }
-                std::string str(strBuffer.begin() + offset, strEnd);
-                varData[varStarts[i] + j] = str;
-            }
+        for (std::size_t i = 0; i < packedBuffers.size(); ++i) {
+            const std::size_t numBytes = varCounts[i] * sizeof(VarType);
+            std::memcpy(varData.data() + varStarts[i],
+                        packedBuffers[i].data() + packedOffsets[i], numBytes);
+            packedOffsets[i] += numBytes;
         }
+
         Variable destVar = dest.vars.open(varName);
         if (isParallelIo) {
             Selection memSelect = createBlockSelection(destVar.getDimensions().dimsCur,
                                   0, ioPool.total_nlocs(), false);
             Selection fileSelect = createBlockSelection(destVar.getDimensions().dimsCur,
                                    ioPool.nlocs_start(), ioPool.total_nlocs(), true);
-            destVar.parallelWrite<std::string>(varData, memSelect, fileSelect);
+            destVar.parallelWrite<VarType>(varData, memSelect, fileSelect);
         } else {
-            destVar.write<std::string>(varData);
+            destVar.write<VarType>(varData);
         }
-    } else {
-        // Non io pool ranks. These ranks will always read their data from src, and send it as
-        // is to their assigned io pool rank.
+    }
+}
+
+template <>
+void writePackedVar<std::string>(const IoPool &, const Variable &, const std::string &,
+                                 const std::vector<std::size_t> &,
+                                 const std::vector<std::size_t> &,
+                                 const Dimensions_t, const std::vector<std::vector<char>> &,
+                                 std::vector<std::size_t> &, Group &, const bool) {
+    throw Exception("String variables are not part of the packed io pool transfer",
+                    ioda_Here());
+}
+
+// String data received from one assigned rank: the end offset of each string in the blob,
+// and the concatenated characters of the strings.
+struct PackedStrings {
+    std::vector<std::size_t> offsets;
+    std::vector<char> blob;
+};
+
+// Transfer the data of the string variables dimensioned by nlocs from the non io pool ranks
+// to their io pool rank. Each non io pool rank sends two messages: the end offsets of all of
+// its strings (variable after variable) and the concatenated characters of the strings.
+// The io pool rank knows the number of strings expected from each rank, so it posts all of
+// the offset receives at once, then all of the blob receives sized from the offsets, and
+// the messages can arrive in any order. Returns the received strings (one entry per rank
+// assignment) on io pool ranks, and an empty vector on the other ranks.
+std::vector<PackedStrings> transferPackedStrings(const IoPool & ioPool,
+                                                 const std::vector<PackedVariable> & stringVars) {
+    std::vector<PackedStrings> packedStrings;
+    if (stringVars.empty()) {
+        return packedStrings;
+    }
+    if (ioPool.rank_pool() >= 0) {
+        packedStrings.resize(ioPool.rank_assignment().size());
+        std::vector<eckit::mpi::Request> recvRequests(ioPool.rank_assignment().size());
         for (std::size_t i = 0; i < ioPool.rank_assignment().size(); ++i) {
-            int toRank = ioPool.rank_assignment()[i].first;
-            int tag = mpiTagBase + (varNumber * varNumTagFactor) + ioPool.rank_all();
-            std::vector<char> strBuffer(varCounts[i] * maxStringLength, '\0');
-            for (std::size_t i = 0; i < varData.size(); ++i) {
-                for (std::size_t j = 0; j < varData[i].size(); ++j) {
-                    std::size_t bufIndx = (i * maxStringLength) + j;
-                    strBuffer[(i * maxStringLength) + j] = varData[i][j];
-                }
+            int fromRank = ioPool.rank_assignment()[i].first;
+            std::size_t numStrings = 0;
+            for (auto & stringVar : stringVars) {
+                numStrings += ioPool.rank_assignment()[i].second * stringVar.dimFactor;
+            }
+            checkMessageSize(numStrings * sizeof(std::size_t));
+            packedStrings[i].offsets.resize(numStrings);
+            recvRequests[i] = ioPool.comm_all().iReceive(
+                packedStrings[i].offsets.data(), numStrings, fromRank, stringOffsetsTag);
+        }
+        ioPool.comm_all().waitAll(recvRequests);
+
+        for (std::size_t i = 0; i < ioPool.rank_assignment().size(); ++i) {
+            int fromRank = ioPool.rank_assignment()[i].first;
+            const std::vector<std::size_t> & offsets = packedStrings[i].offsets;
+            packedStrings[i].blob.resize(offsets.empty() ? 0 : offsets.back());
+            recvRequests[i] = ioPool.comm_all().iReceive(
+                packedStrings[i].blob.data(), packedStrings[i].blob.size(), fromRank,
+                stringBlobTag);
+        }
+        ioPool.comm_all().waitAll(recvRequests);
+    } else {
+        // Non io pool ranks. Pack the strings of all of the variables, then send them to the
+        // assigned io pool rank.
+        PackedStrings myStrings;
+        for (auto & stringVar : stringVars) {
+            std::vector<std::string> varData;
+            stringVar.var.read<std::string>(varData);
+            for (auto & str : varData) {
+                myStrings.blob.insert(myStrings.blob.end(), str.begin(), str.end());
+                myStrings.offsets.push_back(myStrings.blob.size());
             }
-            ioPool.comm_all().send(strBuffer.data(), strBuffer.size(), toRank, tag);
         }
+        checkMessageSize(myStrings.offsets.size() * sizeof(std::size_t));
+        checkMessageSize(myStrings.blob.size());
+        std::vector<eckit::mpi::Request> sendRequests;
+        for (auto & rankAssignment : ioPool.rank_assignment()) {
+            int toRank = rankAssignment.first;
+            sendRequests.push_back(ioPool.comm_all().iSend(
+                myStrings.offsets.data(), myStrings.offsets.size(), toRank, stringOffsetsTag));
+            sendRequests.push_back(ioPool.comm_all().iSend(
+                myStrings.blob.data(), myStrings.blob.size(), toRank, stringBlobTag));
+        }
+        ioPool.comm_all().waitAll(sendRequests);
     }
+    return packedStrings;
 }
 
-template <typename VarType>
-void createVariable(const std::string & varName, const Variable & srcVar,
-                    const int adjustNlocs, Has_Variables & destVars,
-                    const std::size_t strLen) {
-    VariableCreationParameters params = srcVar.getCreationParameters(false, false);
-    Dimensions varDims = srcVar.getDimensions();
-    // If adjust Nlocs is >= 0, this means that this is a variable that needs
-    // to be created with the total number of locations from the MPI tasks in the pool.
-    if (adjustNlocs >= 0) {
-        varDims.dimsCur[0] = adjustNlocs;
-        if (varDims.dimsMax[0] != ioda::Unlimited) {
-            varDims.dimsMax[0] = adjustNlocs;
+// On io pool ranks, assemble the data of a string variable dimensioned by nlocs from the data
+// on this rank and the strings received with transferPackedStrings. stringCursors holds the
+// index of the first string of the variable in the data from each rank and is advanced past
+// the variable. Returns an empty vector on the other ranks.
+std::vector<std::string> assembleStringVar(const IoPool & ioPool, const Variable & srcVar,
+                                           const std::vector<std::size_t> & varStarts,
+                                           const std::vector<std::size_t> & varCounts,
+                                           const Dimensions_t dimFactor,
+                                           const std::vector<PackedStrings> & packedStrings,
+                                           std::vector<std::size_t> & stringCursors) {
+    std::vector<std::string> varData;
+    if (ioPool.rank_pool() >= 0) {
+        srcVar.read<std::string>(varData);
+        // Resize varData according to total nlocs.
+        Dimensions_t numElements = ioPool.total_nlocs() * dimFactor;
+        varData.resize(numElements);
+        for (std::size_t i = 0; i < packedStrings.size(); ++i) {
+            const std::vector<std::size_t> & offsets = packedStrings[i].offsets;
+            const std::vector<char> & blob = packedStrings[i].blob;
+            for (std::size_t j = 0; j < varCounts[i]; ++j) {
+                const std::size_t istr = stringCursors[i] + j;
+                const std::size_t strStart = (istr == 0) ? 0 : offsets[istr - 1];
+                varData[varStarts[i] + j].assign(blob.begin() + strStart,
+                                                 blob.begin() + offsets[istr]);
+            }
+            stringCursors[i] += varCounts[i];
         }
     }
-    Variable destVar = destVars.create<VarType>(varName, varDims, params);
-    copyAttributes(srcVar.atts, destVar.atts);
+    return varData;
 }
 
-// createVariable specialization for string
-template <>
-void createVariable<std::string>(const std::string & varName, const Variable & srcVar,
-                                 const int adjustNlocs, Has_Variables & destVars,
-                                 const std::size_t strLen) {
-    // Since the fill value is coming from a variable length string, and we are
-    // writing out a fixed length string, the fill value might be a longer length
-    // than the string length. For now, record the fill value in an attribute
-    // named "_orig_fill_value" and unset the fill value for the fixed length string.
-    // The origFillValue attribute can be used by the "convert back to variable length
-    // string" application to restore the fill value.
+// Gather the blocks of string values held by the io pool ranks onto io pool rank 0, in
+// io pool rank order (which is the order of the blocks along nlocs in the output file).
+// All of the variables are gathered together: each io pool rank sends one message with the
+// number of values of each variable, one with the lengths of all of the values and one with
+// their concatenated characters. On return, each entry of varValues holds the concatenated
+// values of its variable on io pool rank 0 and is empty on the other io pool ranks.
+void gatherStringsToPoolRoot(const IoPool & ioPool,
+                             const std::vector<std::vector<std::string> *> & varValues) {
+    if (varValues.empty()) {
+        return;
+    }
+    const eckit::mpi::Comm & poolComm = *ioPool.comm_pool();
+    const std::size_t numVars = varValues.size();
+    if (ioPool.rank_pool() == 0) {
+        for (int fromRank = 1; fromRank < ioPool.size_pool(); ++fromRank) {
+            std::vector<std::size_t> numValues(numVars);
+            poolComm.receive(numValues.data(), numVars, fromRank, stringGatherTagBase);
+            std::vector<std::size_t> lengths(std::accumulate(numValues.begin(),
+                numValues.end(), static_cast<std::size_t>(0)));
+            poolComm.receive(lengths.data(), lengths.size(), fromRank,
+                             stringGatherTagBase + 1);
+            std::vector<char> chars(std::accumulate(lengths.begin(), lengths.end(),
+                                                    static_cast<std::size_t>(0)));
+            poolComm.receive(chars.data(), chars.size(), fromRank, stringGatherTagBase + 2);
+            auto nextLength = lengths.begin();
+            auto nextChar = chars.begin();
+            for (std::size_t ivar = 0; ivar < numVars; ++ivar) {
+                for (std::size_t i = 0; i < numValues[ivar]; ++i) {
+                    varValues[ivar]->emplace_back(nextChar, nextChar + *nextLength);
+                    nextChar += *nextLength;
+                    ++nextLength;
+                }
+            }
+        }
+    } else {
+        std::vector<std::size_t> numValues(numVars);
+        std::vector<std::size_t> lengths;
+        std::vector<char> chars;
+        for (std::size_t ivar = 0; ivar < numVars; ++ivar) {
+            numValues[ivar] = varValues[ivar]->size();
+            for (auto & value : *varValues[ivar]) {
+                lengths.push_back(value.size());
+                chars.insert(chars.end(), value.begin(), value.end());
+            }
+            varValues[ivar]->clear();
+        }
+        checkMessageSize(lengths.size() * sizeof(std::size_t));
+        checkMessageSize(chars.size());
+        poolComm.send(numValues.data(), numVars, 0, stringGatherTagBase);
+        poolComm.send(lengths.data(), lengths.size(), 0, stringGatherTagBase + 1);
+        poolComm.send(chars.data(), chars.size(), 0, stringGatherTagBase + 2);
+    }
+}
+
+template <typename VarType>
+void createVariable(const std::string & varName, const Variable & srcVar,
+                    const int adjustNlocs, Has_Variables & destVars) {
     VariableCreationParameters params = srcVar.getCreationParameters(false, false);
-    auto fv = srcVar.getFillValue();
-    std::string origFillValue = detail::getFillValue<std::string>(fv);
-    params.unsetFillValue();
     Dimensions varDims = srcVar.getDimensions();
     // If adjust Nlocs is >= 0, this means that this is a variable that needs
     // to be created with the total number of locations from the MPI tasks in the pool.
@@ -263,13 +449,8 @@ void createVariable<std::string>(const std::string & varName, const Variable & s
             varDims.dimsMax[0] = adjustNlocs;
         }
     }
-    // Set the string length in a specialized type.
-    Type fixedStrType =
-        destVars.getTypeProvider()->makeStringType(typeid(std::string), strLen);
-
-    Variable destVar = destVars.create(varName, fixedStrType, varDims, params);
+    Variable destVar = destVars.create<VarType>(varName, varDims, params);
     copyAttributes(srcVar.atts, destVar.atts);
-    destVar.atts.add<std::string>("_orig_fill_value", origFillValue);
 }
 
 void identifyVarsUsingNlocs(const ioda::VarUtils::VarDimMap & varDimMap,
@@ -288,14 +469,71 @@ void copyVarData(const ioda::IoPool & ioPool, const ioda::Group & src, ioda::Gro
                  const VarUtils::Vec_Named_Variable & srcNamedVars,
                  const std::unordered_set<std::string> & varsUsingNlocs,
                  const bool isParallelIo,
-                 const std::map<std::string, std::size_t> & maxStringLengths){
+                 std::vector<DeferredStringVariable> & deferredStringVars){
   // For ranks in the io pool, collect the variable data and write out to the file. The
   // ranks not in the io pool will participate only in the MPI send/recv calls.
-  int varNumber = 1;
+
+  // The variables dimensioned by nlocs are transferred together: the numeric variables with
+  // a single message from each rank not in the io pool, and the string variables with a
+  // message of string offsets and a message of characters.
+  std::vector<PackedVariable> packedVars;
+  std::vector<PackedVariable> packedStringVars;
+  for (auto & srcNamedVar : srcNamedVars) {
+    if (varsUsingNlocs.count(srcNamedVar.name) == 0) {
+        continue;
+    }
+    if (srcNamedVar.var.isA<std::string>()) {
+        PackedVariable stringVar;
+        stringVar.name = srcNamedVar.name;
+        stringVar.var = srcNamedVar.var;
+        stringVar.dimFactor = calcDimFactor(stringVar.var);
+        stringVar.elementSize = 0;
+        packedStringVars.push_back(stringVar);
+    } else {
+        PackedVariable packedVar;
+        packedVar.name = srcNamedVar.name;
+        packedVar.var = srcNamedVar.var;
+        packedVar.dimFactor = calcDimFactor(packedVar.var);
+        VarUtils::forAnySupportedVariableType(
+            packedVar.var,
+            [&](auto typeDiscriminator) {
+                packedVar.elementSize = sizeof(typeDiscriminator);
+            },
+            VarUtils::ThrowIfVariableIsOfUnsupportedType(packedVar.name));
+        packedVars.push_back(packedVar);
+    }
+  }
+  const std::vector<std::vector<char>> packedBuffers = transferPackedVars(ioPool, packedVars);
+  std::vector<std::size_t> packedOffsets(packedBuffers.size(),
+                                         packedVars.size() * sizeof(std::uint64_t));
+  const std::vector<PackedStrings> packedStrings =
+      transferPackedStrings(ioPool, packedStringVars);
+  std::vector<std::size_t> stringCursors(packedStrings.size(), 0);
+  std::vector<std::vector<std::string> *> gatheredStringValues;
+
   for (auto & srcNamedVar : srcNamedVars) {
     std::string varName = srcNamedVar.name;
     Variable srcVar = srcNamedVar.var;
     bool varTypeSupported = true;
+    auto deferredVar = std::find_if(deferredStringVars.begin(), deferredStringVars.end(),
+        [&varName](const DeferredStringVariable & var) { return var.name == varName; });
+    if (deferredVar != deferredStringVars.end()) {
+        // Collect the values on io pool rank 0, which writes them once the parallel
+        // writes are done. The blocks of the variables dimensioned by nlocs are gathered
+        // together after this loop.
+        if (varsUsingNlocs.count(varName) > 0) {
+            std::vector<std::size_t> varStarts;
+            std::vector<std::size_t> varCounts;
+            Dimensions_t dimFactor;
+            calcVarStartsCounts(ioPool, srcVar, varStarts, varCounts, dimFactor);
+            deferredVar->values = assembleStringVar(ioPool, srcVar,
+                varStarts, varCounts, dimFactor, packedStrings, stringCursors);
+            gatheredStringValues.push_back(&deferredVar->values);
+        } else if (ioPool.rank_pool() == 0) {
+            srcVar.read<std::string>(deferredVar->values);
+        }
+        continue;
+    }
     // Only the variable using the nlocs dimension will need to use MPI send/recv.
     // If the variable is not using nlocs, then simply transfer data from src to dest.
     if(varsUsingNlocs.count(varName) > 0) {
@@ -306,21 +544,25 @@ void copyVarData(const ioda::IoPool & ioPool, const ioda::Group & src, ioda::Gro
         Dimensions_t dimFactor;
         calcVarStartsCounts(ioPool, srcVar, varStarts, varCounts, dimFactor);
 
-        std::size_t strLen = 0;
-        if (maxStringLengths.find(varName) != maxStringLengths.end()) {
-            strLen = maxStringLengths.at(varName);
+        if (srcVar.isA<std::string>()) {
+            std::vector<std::string> varData = assembleStringVar(ioPool, srcVar,
+                varStarts, varCounts, dimFactor, packedStrings, stringCursors);
+            if (ioPool.rank_pool() >= 0) {
+                Variable destVar = dest.vars.open(varName);
+                destVar.write<std::string>(varData);
+            }
+        } else {
+            VarUtils::forAnySupportedVariableType(
+                srcVar,
+                [&](auto typeDiscriminator) {
+                    typedef decltype(typeDiscriminator) T;
+                    writePackedVar<T>(ioPool, srcVar, varName, varStarts, varCounts,
+                                      dimFactor, packedBuffers, packedOffsets, dest,
+                                      isParallelIo);
+                },
+                VarUtils::ThrowIfVariableIsOfUnsupportedType(varName));
         }
 
-        VarUtils::forAnySupportedVariableType(
-            srcVar,
-            [&](auto typeDiscriminator) {
-                typedef decltype(typeDiscriminator) T;
-                transferVarDataMPI<T>(ioPool, srcVar, varName, varNumber,
-                                      varStarts, varCounts, dimFactor, dest,
-                                      isParallelIo, strLen);
-            },
-            VarUtils::ThrowIfVariableIsOfUnsupportedType(varName));
-
     } else {
         // Var is not using nlocs -> simply transfer data from this process. Ie, the
         // assumption is that all ranks have the same identical copies of this variable
@@ -333,52 +575,17 @@ void copyVarData(const ioda::IoPool & ioPool, const ioda::Group & src, ioda::Gro
             },
             VarUtils::ThrowIfVariableIsOfUnsupportedType(varName));
     }
-    varNumber += 1;
+  }
+  if (ioPool.rank_pool() >= 0) {
+    gatherStringsToPoolRoot(ioPool, gatheredStringValues);
   }
 }
 
 // public functions
 
-void calcMaxStringLengths(const ioda::IoPool & ioPool,
-                          const VarUtils::Vec_Named_Variable & allVarsList,
-                          std::map<std::string, std::size_t> & maxStringLengths) {
-    // Want to collect from every mpi task (comm_all_ communicator group).
-    //
-    // Walk through all variables and figure out the max string length which must
-    // be done over the entire set of obs spaces.
-    maxStringLengths.clear();
-    for (auto & namedVar : allVarsList) {
-        std::string varName = namedVar.name;
-        Variable var = namedVar.var;
-        if (var.isA<std::string>()) {
-            // Variable is a string type. Read in the values and find the maximum
-            // string length. Then do an allReduce to send the maximum of all ranks
-            // to every rank.
-            std::vector<std::string> varData;
-            var.read(varData);
-            std::size_t maxStringLen = 0;
-            for (std::size_t i = 0; i < varData.size(); ++i) {
-                if (varData[i].size() > maxStringLen) {
-                    maxStringLen = varData[i].size();
-                }
-            }
-            std::size_t globalMaxStringLen;
-            ioPool.comm_all()
-                .allReduce(maxStringLen, globalMaxStringLen, eckit::mpi::max());
-            // If all of the strings are empty, then globalMaxStringLen is set to
-            // zero which causes problems with the fixed length string type. In this
-            // case, set the globalMaxStringLen to 1.
-            if (globalMaxStringLen == 0) {
-                globalMaxStringLen = 1;
-            }
-            maxStringLengths
-                .insert(std::pair<std::string, std::size_t>(varName, globalMaxStringLen));
-        }
-    }
-}
-
 void ioWriteGroup(const ioda::IoPool & ioPool, const ioda::Group& memGroup,
-                  ioda::Group& fileGroup, const bool isParallelIo) {
+                  ioda::Group& fileGroup, const bool isParallelIo,
+                  std::vector<DeferredStringVariable> & deferredStringVars) {
   using namespace ioda;
   using namespace std;
 
@@ -404,10 +611,30 @@ void ioWriteGroup(const ioda::IoPool & ioPool, const ioda::Group& memGroup,
   std::unordered_set<std::string> varsUsingNlocs;
   identifyVarsUsingNlocs(dimsAttachedToVars, varsUsingNlocs);
 
-  // We need to adjust any string variables to be output as fixed length strings which
-  // entails knowing the maximum string length.
-  std::map<std::string, std::size_t> maxStringLengths;
-  calcMaxStringLengths(ioPool, allVarsList, maxStringLengths);
+  // String variables are written as variable length strings, which HDF5 cannot do in
+  // parallel io mode. In that mode, hold them back from the parallel writes (all ranks
+  // need to agree on this list since they all take part in the transfers).
+  deferredStringVars.clear();
+  std::unordered_set<std::string> deferredVarNames;
+  if (isParallelIo) {
+    int poolNlocs = ioPool.global_nlocs();
+    for (const auto& namedVar : regularVarList) {
+      if (namedVar.var.isA<std::string>()) {
+        DeferredStringVariable deferredVar;
+        deferredVar.name = namedVar.name;
+        deferredVar.adjustNlocs = varsUsingNlocs.count(namedVar.name) ? poolNlocs : -1;
+        for (const auto &old : dimsAttachedToVars) {
+          if (old.first.name == namedVar.name) {
+            for (const auto &old_dim : old.second) {
+              deferredVar.dimNames.push_back(old_dim.name);
+            }
+          }
+        }
+        deferredVarNames.insert(namedVar.name);
+        deferredStringVars.push_back(std::move(deferredVar));
+      }
+    }
+  }
 
   // For the ranks in the io pool, we need to first create a file (either a single file
   // or one file per rank in the io pool) containing the groups, attributes and variables.
@@ -444,20 +671,19 @@ void ioWriteGroup(const ioda::IoPool & ioPool, const ioda::Group& memGroup,
       // do not adjust. The adjustment is necessary if we are collecting data from multiple
       // MPI tasks.
       std::string var_name = namedVar.name;
+      if (deferredVarNames.count(var_name)) {
+          continue;
+      }
       int adjustNlocs = -1;
       if (varsUsingNlocs.count(var_name)) {
           adjustNlocs = poolNlocs;
       }
       const Variable old_var = namedVar.var;
-      std::size_t strLen = 0;
-      if (maxStringLengths.find(var_name) != maxStringLengths.end()) {
-          strLen = maxStringLengths.at(var_name);
-      }
       VarUtils::forAnySupportedVariableType(
           old_var,
           [&](auto typeDiscriminator) {
               typedef decltype(typeDiscriminator) T;
-              createVariable<T>(var_name, old_var, adjustNlocs, fileGroup.vars, strLen);
+              createVariable<T>(var_name, old_var, adjustNlocs, fileGroup.vars);
           },
           VarUtils::ThrowIfVariableIsOfUnsupportedType(var_name));
     }
@@ -476,6 +702,9 @@ void ioWriteGroup(const ioda::IoPool & ioPool, const ioda::Group& memGroup,
     // since we use a collective call for performance.
     vector<pair<Variable, vector<Variable>>> dimsAttachedToNewVars;
     for (const auto &old : dimsAttachedToVars) {
+      if (deferredVarNames.count(old.first.name)) {
+          continue;
+      }
       Variable new_var = fileGroup.vars[old.first.name];
       vector<Variable> new_dims;
       for (const auto &old_dim : old.second) {
@@ -489,7 +718,27 @@ void ioWriteGroup(const ioda::IoPool & ioPool, const ioda::Group& memGroup,
   // Next for the ranks in the "all" communicator group, we collectively transfer the
   // variable data and write it into the file. 
   copyVarData(ioPool, memGroup, fileGroup, allVarsList, varsUsingNlocs,
-              isParallelIo, maxStringLengths);
+              isParallelIo, deferredStringVars);
+}
+
+void ioWriteDeferredStrings(const ioda::Group& memGroup, ioda::Group& fileGroup,
+                            const std::vector<DeferredStringVariable> & deferredStringVars) {
+  std::vector<std::pair<Variable, std::vector<Variable>>> dimsAttachedToNewVars;
+  for (const auto& deferredVar : deferredStringVars) {
+    const Variable srcVar = memGroup.vars.open(deferredVar.name);
+    createVariable<std::string>(deferredVar.name, srcVar, deferredVar.adjustNlocs,
+                                fileGroup.vars);
+    Variable destVar = fileGroup.vars.open(deferredVar.name);
+    destVar.write<std::string>(deferredVar.values);
+    if (!deferredVar.dimNames.empty()) {
+      std::vector<Variable> newDims;
+      for (const auto& dimName : deferredVar.dimNames) {
+        newDims.push_back(fileGroup.vars.open(dimName));
+      }
+      dimsAttachedToNewVars.push_back(std::make_pair(destVar, std::move(newDims)));
+    }
+  }
+  fileGroup.vars.attachDimensionScales(dimsAttachedToNewVars);
 }
 
 }  // namespace ioda
@@ -88,6 +88,9 @@ class ObsFrame : public util::Printable {
     /// \brief return number of maximum variable size (along first dimension) from backend
     Dimensions_t backendMaxVarSize() const {return backend_max_var_size_;}
 
+    /// \brief return maximum number of locations in a frame
+    Dimensions_t maxFrameSize() const {return max_frame_size_;}
+
     /// \brief return the backend (not the frame) obs group
     ObsGroup backendObsGroup() const {return obs_data_in_->getObsGroup();}
 
@@ -5,61 +5,295 @@
  * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0. 
  */
 
+#include <fnmatch.h>
+#include <sys/stat.h>
+
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <numeric>
+#include <sstream>
+#include <utility>
+
+#include "eckit/mpi/Comm.h"
 
 #include "oops/util/Logger.h"
 
+#include "ioda/distribution/DistributionCache.h"
 #include "ioda/distribution/DistributionFactory.h"
 #include "ioda/Exception.h"
 #include "ioda/Copying.h"
+#include "ioda/Engines/ReaderBase.h"
 #include "ioda/io/ObsFrameRead.h"
+#include "ioda/io/ObsSourceLayout.h"
 #include "ioda/Variables/VarUtils.h"
 
 namespace ioda {
 
 namespace detail {
-  using std::to_string;
+  /// \brief append the obs grouping key segments for the values of one grouping variable
+  /// \param values variable values for the current frame
+  /// \param frameIndex frame indices of the locations being grouped
+  /// \param groupingKeys keys being built
+  template <typename VarType>
+  void appendGroupingKeySegments(const std::vector<VarType> & values,
+                                 const std::vector<Dimensions_t> & frameIndex,
+                                 ObsGroupingKeys & groupingKeys) {
+    std::vector<std::uint64_t> segments(frameIndex.size());
+    for (std::size_t j = 0; j < frameIndex.size(); ++j) {
+      segments[j] = groupingKeySegment(values[frameIndex[j]]);
+    }
+    groupingKeys.appendNumericSegments(segments);
+  }
+
+  void appendGroupingKeySegments(const std::vector<std::string> & values,
+                                 const std::vector<Dimensions_t> & frameIndex,
+                                 ObsGroupingKeys & groupingKeys) {
+    std::vector<std::string> segments(frameIndex.size());
+    for (std::size_t j = 0; j < frameIndex.size(); ++j) {
+      segments[j] = values[frameIndex[j]];
+    }
+    groupingKeys.appendStringSegments(std::move(segments));
+  }
+
+  /// Pack strings into a vector of lengths and a concatenated character buffer.
+  void packStrings(const std::vector<std::string> & strings,
+                   std::vector<std::size_t> & lengths, std::vector<char> & chars) {
+    lengths.resize(strings.size());
+    std::size_t totalLength = 0;
+    for (std::size_t i = 0; i < strings.size(); ++i) {
+      lengths[i] = strings[i].size();
+      totalLength += lengths[i];
+    }
+    chars.clear();
+    chars.reserve(totalLength);
+    for (auto & str : strings) {
+      chars.insert(chars.end(), str.begin(), str.end());
+    }
+  }
+
+  /// Unpack strings from a vector of lengths and a concatenated character buffer.
+  void unpackStrings(const std::vector<std::size_t> & lengths, const std::vector<char> & chars,
+                     std::vector<std::string> & strings) {
+    strings.resize(lengths.size());
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i < lengths.size(); ++i) {
+      strings[i].assign(chars.data() + offset, lengths[i]);
+      offset += lengths[i];
+    }
+  }
+
+  /// Broadcast frame data from the root process of a read pool group.
+  template <typename DataType>
+  void broadcastFrameData(const eckit::mpi::Comm & comm, std::vector<DataType> & data,
+                          const std::size_t root) {
+    std::size_t dataSize = data.size();
+    comm.broadcast(dataSize, root);
+    data.resize(dataSize);
+    if (dataSize > 0) {
+      comm.broadcast(data.begin(), data.end(), root);
+    }
+  }
+
+  void broadcastFrameData(const eckit::mpi::Comm & comm, std::vector<std::string> & data,
+                          const std::size_t root) {
+    std::vector<std::size_t> lengths;
+    std::vector<char> chars;
+    if (comm.rank() == root) {
+      packStrings(data, lengths, chars);
+    }
+    broadcastFrameData<std::size_t>(comm, lengths, root);
+    broadcastFrameData<char>(comm, chars, root);
+    unpackStrings(lengths, chars, data);
+  }
+
+  /// Send frame data to another process of a read pool group.
+  template <typename DataType>
+  void sendFrameData(const eckit::mpi::Comm & comm, const std::vector<DataType> & data,
+                     const int dest, const int tag) {
+    std::size_t dataSize = data.size();
+    comm.send(dataSize, dest, tag);
+    if (dataSize > 0) {
+      comm.send(data.data(), dataSize, dest, tag);
+    }
+  }
+
+  void sendFrameData(const eckit::mpi::Comm & comm, const std::vector<std::string> & data,
+                     const int dest, const int tag) {
+    std::vector<std::size_t> lengths;
+    std::vector<char> chars;
+    packStrings(data, lengths, chars);
+    sendFrameData<std::size_t>(comm, lengths, dest, tag);
+    sendFrameData<char>(comm, chars, dest, tag);
+  }
+
+  /// Receive frame data from another process of a read pool group.
+  template <typename DataType>
+  void receiveFrameData(const eckit::mpi::Comm & comm, std::vector<DataType> & data,
+                        const int source, const int tag) {
+    std::size_t dataSize;
+    comm.receive(dataSize, source, tag);
+    data.resize(dataSize);
+    if (dataSize > 0) {
+      comm.receive(data.data(), dataSize, source, tag);
+    }
+  }
+
+  void receiveFrameData(const eckit::mpi::Comm & comm, std::vector<std::string> & data,
+                        const int source, const int tag) {
+    std::vector<std::size_t> lengths;
+    std::vector<char> chars;
+    receiveFrameData<std::size_t>(comm, lengths, source, tag);
+    receiveFrameData<char>(comm, chars, source, tag);
+    unpackStrings(lengths, chars, data);
+  }
+
+  /// \brief flag the locations to keep from a frame
+  /// \details A location is kept when its datetime is inside the DA timing window
+  /// (start exclusive, end inclusive) and its latitude and longitude are not fill values.
+  /// The datetimes are compared as offsets from their epoch, so the window bounds need to
+  /// be expressed as offsets from the same epoch. The loop is free of branches so that it
+  /// can be vectorized.
+  /// \return number of locations inside the timing window
+  std::size_t flagLocationsToKeep(const int64_t * timeOffsets, const float * lats,
+                                  const float * lons, const std::size_t numLocs,
+                                  const int64_t windowStartOffset,
+                                  const int64_t windowEndOffset,
+                                  const float latFillValue, const float lonFillValue,
+                                  unsigned char * keepFlags) {
+    std::size_t numInsideWindow = 0;
+    for (std::size_t i = 0; i < numLocs; ++i) {
+      const unsigned char insideWindow =
+          (timeOffsets[i] > windowStartOffset) & (timeOffsets[i] <= windowEndOffset);
+      numInsideWindow += insideWindow;
+      keepFlags[i] = insideWindow & (lats[i] != latFillValue) & (lons[i] != lonFillValue);
+    }
+    return numInsideWindow;
+  }
+
+  /// Return true if the name matches any of the glob style patterns.
+  bool matchesAnyPattern(const std::string & name, const std::vector<std::string> & patterns) {
+    for (auto & pattern : patterns) {
+      if (fnmatch(pattern.c_str(), name.c_str(), 0) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// Copy the selected rows of a frame variable into a contiguous buffer.
+  template <typename DataType>
+  std::vector<DataType> extractFrameRows(const std::vector<DataType> & frameData,
+                                         const std::vector<Dimensions_t> & rowIndex,
+                                         const std::size_t rowSize) {
+    std::vector<DataType> rowData(rowIndex.size() * rowSize);
+    for (std::size_t i = 0; i < rowIndex.size(); ++i) {
+      std::copy_n(frameData.begin() + rowIndex[i] * rowSize, rowSize,
+                  rowData.begin() + i * rowSize);
+    }
+    return rowData;
+  }
+
+  /// Return a string identifying the version of an obs source file (its name, size and
+  /// modification time), or an empty string if there is no such file.
+  std::string obsSourceSignature(const std::string & fileName) {
+    std::ostringstream signature;
+    struct stat fileStatus;
+    if (!fileName.empty() && (stat(fileName.c_str(), &fileStatus) == 0)) {
+      signature << fileName << ":" << fileStatus.st_size << ":" << fileStatus.st_mtime;
+    }
+    return signature.str();
+  }
 
-  /// An overload of to_string() taking a string and returning the same string.
-  std::string to_string(std::string s) {
-    return s;
+  /// Build the key under which the distribution of an ObsSpace is stored in the
+  /// DistributionCache. It covers everything the assignment of records to PEs depends on:
+  /// the communicator, the timing window, the obs source (engine options plus the
+  /// signature of the file, if there is one), the obs grouping and the distribution
+  /// parameters.
+  std::string distributionCacheKey(const ObsSpaceParameters & params,
+                                   const std::string & sourceSignature) {
+    const ObsDataInParameters & obsDataIn = params.top_level_.obsDataIn.value();
+    std::ostringstream key;
+    key << params.comm().name() << ":" << params.comm().size() << "|"
+        << params.windowStart() << "|" << params.windowEnd() << "|"
+        << obsDataIn.engine.value().toConfiguration() << "|";
+    if (!sourceSignature.empty()) {
+      key << sourceSignature << "|";
+    }
+    key << obsDataIn.obsGrouping.value().toConfiguration() << "|"
+        << params.top_level_.distribution.value().params.value().toConfiguration();
+    return key.str();
   }
+
+  /// \brief stand-in for the obs source reader on the read pool members
+  /// \details The members of a read pool group do not open the obs source. Their obs group
+  /// holds the layout of the obs source received from the reader of the group, which is
+  /// enough to set up the frames and the ObsSpace.
+  class ReadPoolMemberReader : public Engines::ReaderBase {
+   public:
+    ReadPoolMemberReader(const ObsSpaceParameters & params, const ObsGroup & layoutGroup,
+                         const std::string & fileName)
+        : Engines::ReaderBase(params.windowStart(), params.windowEnd(),
+                              params.comm(), params.timeComm(),
+                              params.top_level_.simVars.value().variables()) {
+      obs_group_ = layoutGroup;
+      fileName_ = fileName;
+    }
+
+   private:
+    void print(std::ostream & os) const override {
+      os << "ReadPoolMemberReader: layout of " << fileName_ << std::endl;
+    }
+  };
 }  // namespace detail
 
+// Default maximum number of readers, matching the default size of the output io pool.
+constexpr int defaultMaxReadPoolSize = 10;
+
+// MPI tag used for the transfers between a reader and the other members of its group.
+constexpr int readPoolTag = 30000;
+
+const char readPoolCommName[] = "ReadPool";
+
 //--------------------------- public functions ---------------------------------------
 //------------------------------------------------------------------------------------
 ObsFrameRead::ObsFrameRead(const ObsSpaceParameters & params) :
     ObsFrame(params) {
-    // Create the backend engine object. Use the "simulated variables" spec from
-    // the YAML (params.top_level_.simVars) since that is the required spec, thus
-    // the only list guaranteed to be available at this time (ie, before reading
-    // the obs input and constructing the ObsSpace).
-    obs_data_in_ = Engines::ReaderFactory::create(
-        params.top_level_.obsDataIn.value().engine.value().engineParameters,
-        params.windowStart(), params.windowEnd(),
-        params.comm(), params.timeComm(),
-        params.top_level_.simVars.value().variables());
+    const ObsDataInParameters & obsDataIn = params.top_level_.obsDataIn.value();
 
-    ObsGroup og = obs_data_in_->getObsGroup();
+    // Set up the read pool if requested
+    read_pool_comm_ = nullptr;
+    is_frame_reader_ = true;
+    if (obsDataIn.ioPool.value() != boost::none) {
+        createReadPool(*obsDataIn.ioPool.value());
+    }
 
-    // Find out what datetime representation exists in the input
-    // Precedence is epoch first, then string, then offset.
-    use_epoch_datetime_ = og.vars.exists("MetaData/dateTime");
-    use_string_datetime_ = og.vars.exists("MetaData/datetime");
-    use_offset_datetime_ = og.vars.exists("MetaData/time");
-    if (use_epoch_datetime_) {
-      use_string_datetime_ = false;
-      use_offset_datetime_ = false;
-    } else if (use_string_datetime_) {
-      use_offset_datetime_ = false;
+    // record variables by which observations should be grouped into records
+    obs_grouping_vars_ = obsDataIn.obsGrouping.value().obsGroupVars;
+    read_owned_locations_only_ = obsDataIn.readOwnedLocationsOnly;
+
+    // When using a read pool, only the readers open the obs source. Each reader sends the
+    // layout of the obs source to the other members of its group. The generators are
+    // created on every process since they do not open a file.
+    const std::string engineType = obsDataIn.engine.value().engineParameters.value().type.value();
+    const bool shareSourceLayout = (read_pool_comm_ != nullptr) &&
+        (engineType != "GenList") && (engineType != "GenRandom");
+    std::string sourceSignature;
+    if (is_frame_reader_ || !shareSourceLayout) {
+        initFromObsSource(params);
+        sourceSignature = detail::obsSourceSignature(obs_data_in_->fileName());
+    }
+    if (shareSourceLayout) {
+        shareObsSourceLayout(params, sourceSignature);
     }
 
     // Check to see if required metadata variables exist
     bool haveRequiredMetadata =
         use_epoch_datetime_ || use_string_datetime_ || use_offset_datetime_;
-    haveRequiredMetadata = haveRequiredMetadata && og.vars.exists("MetaData/latitude");
-    haveRequiredMetadata = haveRequiredMetadata && og.vars.exists("MetaData/longitude");
+    haveRequiredMetadata = haveRequiredMetadata && backend_vars_.count("MetaData/latitude");
+    haveRequiredMetadata = haveRequiredMetadata && backend_vars_.count("MetaData/longitude");
     if (!haveRequiredMetadata) {
       std::string errorMsg =
           std::string("\nOne or more of the following metadata variables are missing ") +
@@ -86,33 +320,99 @@ ObsFrameRead::ObsFrameRead(const ObsSpaceParameters & params) :
                         << std::endl;
     }
 
-    // Collect information from the backend which will help with frame initialization
-    // and frame looping. Note the call to collectVarDimInfo will cache variable
-    // and dimension information from the backend since doing these on the fly is
-    // very slow with the HDF5 backend.
-    VarUtils::collectVarDimInfo(og, backend_var_list_, backend_dim_var_list_,
-                                backend_dims_attached_to_vars_, backend_max_var_size_);
-
-    // record number of locations from backend
-    backend_nlocs_ = og.vars.open("nlocs").getDimensions().dimsCur[0];
     if (backend_nlocs_ == 0) {
       oops::Log::info() << "WARNING: Input file " << obs_data_in_->fileName()
                         << " contains zero observations" << std::endl;
     }
-
-    // record variables by which observations should be grouped into records
-    obs_grouping_vars_ = params.top_level_.obsDataIn.value().obsGrouping.value().obsGroupVars;
+    oops::Log::debug() << "ObsFrameRead: maximum frame size: " << max_frame_size_ << std::endl;
 
     // Create an MPI distribution
     const auto & distParams = params.top_level_.distribution.value().params.value();
     distname_ = distParams.name;
-    dist_ = DistributionFactory::create(params.comm(), distParams);
+    dist_from_cache_ = false;
+    if (distParams.cacheOwnership) {
+      // Reuse the distribution of an earlier ObsSpace reading the same locations. All PEs
+      // must agree, since a fresh distribution needs every PE to assign the records.
+      dist_cache_key_ = detail::distributionCacheKey(params, sourceSignature);
+      std::shared_ptr<Distribution> cachedDist = DistributionCache::find(dist_cache_key_);
+      int cacheHit = (cachedDist != nullptr);
+      params.comm().allReduceInPlace(cacheHit, eckit::mpi::min());
+      if (cacheHit) {
+        oops::Log::info() << "Reusing the " << distname_ << " distribution of an earlier "
+                          << "obs space reading " << obs_data_in_->fileName() << std::endl;
+        dist_ = cachedDist;
+        dist_from_cache_ = true;
+      }
+    }
+    if (!dist_from_cache_) {
+      dist_ = DistributionFactory::create(params.comm(), distParams);
+    }
 
-    max_frame_size_ = params.top_level_.obsDataIn.value().maxFrameSize;
-    oops::Log::debug() << "ObsFrameRead: maximum frame size: " << max_frame_size_ << std::endl;
+    // The background read must not make MPI calls so prefetching is only done
+    // when each process reads for itself.
+    prefetch_frames_ = params.top_level_.obsDataIn.value().prefetchFrames;
+    if (prefetch_frames_ && (read_pool_comm_ != nullptr)) {
+        oops::Log::info() << "WARNING: prefetch frames is not supported together with "
+                          << "the read pool, frames will not be prefetched" << std::endl;
+        prefetch_frames_ = false;
+    }
+
+    // Variables dimensioned by nlocs, other than the location metadata, are read straight
+    // from the backend into the caller's buffer by readFrameVar, skipping the frame
+    // container. This is only done when each process reads for itself and the backend is
+    // not busy with a prefetch. The legacy datetime representations (MetaData/datetime and
+    // MetaData/time) are left out: the ObsSpace never stores them, so they must not end up
+    // among the lazily loaded variables either.
+    direct_read_vars_.clear();
+    if (read_owned_locations_only_ && !prefetch_frames_ && (read_pool_comm_ == nullptr)) {
+        for (auto & varNameObject : backend_var_list_) {
+            const std::string & varName = varNameObject.name;
+            if ((varName == "MetaData/datetime") || (varName == "MetaData/time")) {
+                continue;
+            }
+            if ((location_metadata_vars_.count(varName) == 0) &&
+                isVarDimByNlocs_Impl(varName, backend_dims_attached_to_vars_)) {
+                direct_read_vars_.insert(varName);
+            }
+        }
+    }
+
+    // With lazy loading, the variables that would be read directly are not read at all
+    // during the frame loop. Obs extension copies values into the new locations while
+    // the ObsSpace is being constructed, so lazy loading is not used in that case.
+    lazy_load_vars_.clear();
+    if (params.top_level_.obsDataIn.value().lazyLoading) {
+        if (!read_owned_locations_only_ || prefetch_frames_ || (read_pool_comm_ != nullptr)) {
+            oops::Log::info() << "WARNING: lazy loading requires \"read owned locations only\" "
+                              << "and is not supported together with the read pool or "
+                              << "prefetch frames, all variables will be read" << std::endl;
+        } else if (params.top_level_.obsExtend.value() != boost::none) {
+            oops::Log::info() << "WARNING: lazy loading is not supported together with "
+                              << "obs extension, all variables will be read" << std::endl;
+        } else {
+            lazy_load_vars_ = direct_read_vars_;
+        }
+    }
 }
 
-ObsFrameRead::~ObsFrameRead() {}
+ObsFrameRead::~ObsFrameRead() {
+    // Make sure the background thread is no longer using the backend
+    if (prefetch_future_.valid()) {
+        prefetch_future_.wait();
+    }
+    if (read_pool_comm_ != nullptr) {
+        eckit::mpi::deleteComm(read_pool_comm_name_.c_str());
+    }
+}
+
+//------------------------------------------------------------------------------------
+std::map<std::string, Variable> ObsFrameRead::lazyLoadVars() const {
+    std::map<std::string, Variable> lazyVars;
+    for (auto & varName : lazy_load_vars_) {
+        lazyVars[varName] = backend_vars_.at(varName);
+    }
+    return lazyVars;
+}
 
 //------------------------------------------------------------------------------------
 void ObsFrameRead::frameInit(Has_Attributes & destAttrs) {
@@ -129,9 +429,15 @@ void ObsFrameRead::frameInit(Has_Attributes & destAttrs) {
     gnlocs_ = 0;
     nrecs_ = 0;
 
-    // create an ObsGroup based frame with an in-memory backend
+    // create an ObsGroup based frame with an in-memory backend. When prefetching, a
+    // second frame container is needed for the background thread to read into.
     createFrameFromObsGroup(backend_var_list_, backend_dim_var_list_,
                             backend_dims_attached_to_vars_);
+    if (prefetch_frames_) {
+        prefetch_frame_ = obs_frame_;
+        createFrameFromObsGroup(backend_var_list_, backend_dim_var_list_,
+                                backend_dims_attached_to_vars_);
+    }
 
     // copy the global attributes
     copyAttributes(obs_data_in_->getObsGroup().atts, destAttrs);
@@ -155,83 +461,90 @@ void ObsFrameRead::frameNext() {
 bool ObsFrameRead::frameAvailable() {
     bool haveAnotherFrame = (frame_start_ < max_var_size_);
     // If there is another frame, then read it into obs_frame_
-    if (haveAnotherFrame) {
+    if (haveAnotherFrame && prefetch_frames_) {
+        // Pick up the frame that was read on the background thread. The first frame
+        // has not been started yet so read it here.
+        Dimensions_t frameStart = this->frameStart();
+        if (prefetch_future_.valid()) {
+            prefetch_future_.get();
+            std::swap(obs_frame_, prefetch_frame_);
+        } else {
+            readEntireFrame(obs_frame_, frameStart);
+        }
+
+        // Start reading the following frame while this one is being processed
+        Dimensions_t nextFrameStart = frameStart + max_frame_size_;
+        if (nextFrameStart < max_var_size_) {
+            prefetch_future_ = std::async(std::launch::async, [this, nextFrameStart]() {
+                readEntireFrame(prefetch_frame_, nextFrameStart);
+            });
+        }
+
+        // If using the string or offset datetimes, convert those to epoch datetimes
+        convertFrameDatetimes();
+
+        // generate the frame index and record numbers for this frame
+        genFrameIndexRecNums(dist_);
+
+        // clear the selection caches
+        known_frame_selections_.clear();
+        known_mem_selections_.clear();
+        known_direct_mem_selections_.clear();
+        known_obs_io_selections_.clear();
+    } else if (haveAnotherFrame) {
         // Resize along the nlocs dimension
         Variable nlocsVar = obs_frame_.vars.open("nlocs");
         obs_frame_.resize(
             { std::pair<Variable, Dimensions_t>(nlocsVar, frameCount("nlocs")) });
 
-        // Transfer all variable data
+        // Transfer the variable data in two phases. First transfer the variables
+        // needed to decide which locations are kept (timing window and missing
+        // lat/lon checks, obs grouping and the MPI distribution) and generate the frame
+        // index and record numbers. Then transfer the remaining variables. Those that
+        // are read directly from the backend by readFrameVar are skipped here.
         Dimensions_t frameStart = this->frameStart();
         for (auto & varNameObject : backend_var_list_) {
-            std::string varName = varNameObject.name;
-            Variable sourceVar = varNameObject.var;
-            Dimensions_t frameCount = this->basicFrameCount(sourceVar);
-            if (frameCount > 0) {
-                // Transfer the variable data for this frame. Do this in two steps:
-                //    ObsIo --> memory buffer --> frame storage
-
-                // Selection objects for transfer;
-                std::vector<Dimensions_t> varShape = sourceVar.getDimensions().dimsCur;
-                Selection obsIoSelect = createObsIoSelection(varShape, frameStart, frameCount);
-                Selection memBufferSelect = createMemSelection(varShape, frameCount);
-                Selection obsFrameSelect = createEntireFrameSelection(varShape, frameCount);
-
-                // Transfer the data
-                Variable destVar = obs_frame_.vars.open(varName);
-
-                VarUtils::forAnySupportedVariableType(
-                      destVar,
-                      [&](auto typeDiscriminator) {
-                          typedef decltype(typeDiscriminator) T;
-                          std::vector<T> varValues;
-                          sourceVar.read<T>(varValues, memBufferSelect, obsIoSelect);
-                          destVar.write<T>(varValues, memBufferSelect, obsFrameSelect);
-                      },
-                      VarUtils::ThrowIfVariableIsOfUnsupportedType(varName));
+            if (location_metadata_vars_.count(varNameObject.name)) {
+                transferFrameVar(obs_frame_, varNameObject.name, varNameObject.var,
+                                 frameStart);
             }
         }
 
         // If using the string or offset datetimes, convert those to epoch datetimes
-        if (use_string_datetime_) {
-          // Read in string datetimes and convert to time offsets. Use the window
-          // start time as the epoch.
-          std::vector<std::string> dtStrings;
-          Variable stringDtVar = obs_frame_.vars.open("MetaData/datetime");
-          stringDtVar.read<std::string>(dtStrings);
-          std::vector<int64_t> timeOffsets = convertDtStringsToTimeOffsets(
-              params_.windowStart(), dtStrings);
-
-          // Transfer the epoch datetime to the new variable.
-          Variable epochDtVar = obs_frame_.vars.open("MetaData/dateTime");
-          epochDtVar.write<int64_t>(timeOffsets);
-        } else if (use_offset_datetime_) {
-          // Use the date_time global attribute as the epoch. This means that
-          // we just need to convert the float offset times in hours to an
-          // int64_t offset in seconds.
-          std::vector<float> dtTimeOffsets;
-          Variable offsetDtVar = obs_frame_.vars.open("MetaData/time");
-          offsetDtVar.read<float>(dtTimeOffsets);
-
-          std::vector<int64_t> timeOffsets(dtTimeOffsets.size());
-          for (std::size_t i = 0; i < dtTimeOffsets.size(); ++i) {
-            timeOffsets[i] = static_cast<int64_t>(lround(dtTimeOffsets[i] * 3600.0));
-          }
-
-          // Transfer the epoch datetime to the new variable.
-          Variable epochDtVar = obs_frame_.vars.open("MetaData/dateTime");
-          epochDtVar.write<int64_t>(timeOffsets);
-        }
+        convertFrameDatetimes();
 
         // generate the frame index and record numbers for this frame
         genFrameIndexRecNums(dist_);
 
+        if (read_pool_comm_ != nullptr) {
+            collectGroupFrameLocations();
+        }
+        for (auto & varNameObject : backend_var_list_) {
+            std::string varName = varNameObject.name;
+            if (location_metadata_vars_.count(varName) || direct_read_vars_.count(varName)) {
+                continue;
+            }
+            if ((read_pool_comm_ != nullptr) &&
+                isVarDimByNlocs_Impl(varName, backend_dims_attached_to_vars_)) {
+                scatterOwnedFrameVar(varName, varNameObject.var, frameStart);
+            } else {
+                transferFrameVar(obs_frame_, varName, varNameObject.var, frameStart);
+            }
+        }
+
         // clear the selection caches
         known_frame_selections_.clear();
         known_mem_selections_.clear();
+        known_direct_mem_selections_.clear();
+        known_obs_io_selections_.clear();
     } else {
       // assign each record to the patch of a unique PE
-      dist_->computePatchLocs();
+      if (!dist_from_cache_) {
+        dist_->computePatchLocs();
+        if (!dist_cache_key_.empty()) {
+          DistributionCache::insert(dist_cache_key_, dist_);
+        }
+      }
     }
     return (haveAnotherFrame);
 }
@@ -253,15 +566,14 @@ Dimensions_t ObsFrameRead::frameCount(const std::string & varName) {
     } else if (use_offset_datetime_ && (varName == "MetaData/dateTime")) {
         useVarName = "MetaData/time";
     }
-    Variable var = obs_data_in_->getObsGroup().vars.open(useVarName);
     Dimensions_t  fCount;
-    if (var.isDimensionScale()) {
-        fCount = basicFrameCount(var);
+    if (backend_dim_var_names_.count(useVarName)) {
+        fCount = basicFrameCount(useVarName, frame_start_);
     } else {
         if (isVarDimByNlocs_Impl(useVarName, backend_dims_attached_to_vars_)) {
             fCount = adjusted_nlocs_frame_count_;
         } else {
-            fCount = basicFrameCount(var);
+            fCount = basicFrameCount(useVarName, frame_start_);
         }
     }
     return fCount;
@@ -292,11 +604,12 @@ void ObsFrameRead::print(std::ostream & os) const {
 }
 
 //------------------------------------------------------------------------------------
-Dimensions_t ObsFrameRead::basicFrameCount(const Variable & var) {
+Dimensions_t ObsFrameRead::basicFrameCount(const std::string & varName,
+                                           const Dimensions_t frameStart) const {
     Dimensions_t count;
-    Dimensions_t varSize0 = var.getDimensions().dimsCur[0];
-    if ((frame_start_ + max_frame_size_) > varSize0) {
-        count = varSize0 - frame_start_;
+    Dimensions_t varSize0 = backend_var_sizes_.at(varName);
+    if ((frameStart + max_frame_size_) > varSize0) {
+        count = varSize0 - frameStart;
         if (count < 0) { count = 0; }
     } else {
         count = max_frame_size_;
@@ -304,6 +617,36 @@ Dimensions_t ObsFrameRead::basicFrameCount(const Variable & var) {
     return count;
 }
 
+//------------------------------------------------------------------------------------
+std::size_t ObsFrameRead::frameRowBytes() const {
+    // Sum the bytes of one location over the variables dimensioned by nlocs. Variables
+    // with additional dimensions (eg, nchans) hold the product of the sizes of those
+    // dimensions for each location. Strings are counted by the size of the string object.
+    std::size_t rowBytes = 0;
+    for (auto & varNameObject : backend_var_list_) {
+        const std::string & varName = varNameObject.name;
+        if (!isVarDimByNlocs_Impl(varName, backend_dims_attached_to_vars_)) {
+            continue;
+        }
+        const VarUtils::Vec_Named_Variable & varDims =
+            backend_dims_attached_to_vars_.at(varNameObject);
+        std::size_t rowElements = 1;
+        for (std::size_t i = 1; i < varDims.size(); ++i) {
+            rowElements *= backend_var_sizes_.at(varDims[i].name);
+        }
+        std::size_t elementBytes = 0;
+        VarUtils::forAnySupportedVariableType(
+              varNameObject.var,
+              [&](auto typeDiscriminator) {
+                  typedef decltype(typeDiscriminator) T;
+                  elementBytes = sizeof(T);
+              },
+              VarUtils::ThrowIfVariableIsOfUnsupportedType(varName));
+        rowBytes += rowElements * elementBytes;
+    }
+    return rowBytes;
+}
+
 //------------------------------------------------------------------------------------
 Selection ObsFrameRead::createIndexedFrameSelection(const std::vector<Dimensions_t> & varShape) {
     // frame_loc_index_ contains the indices for the first dimension. Subsequent
@@ -319,6 +662,407 @@ Selection ObsFrameRead::createIndexedFrameSelection(const std::vector<Dimensions
     return indexedFrameSelect;
 }
 
+//------------------------------------------------------------------------------------
+Selection ObsFrameRead::createIndexedObsIoSelection(const std::vector<Dimensions_t> & varShape,
+                                                    const Dimensions_t frameStart) {
+    // frame_loc_index_ is in ascending order so coalesce consecutive locations into
+    // (start, count) runs along the first dimension. Subsequent dimensions are selected
+    // in their entirety.
+    std::vector<Dimensions_t> runStarts;
+    std::vector<Dimensions_t> runCounts;
+    for (std::size_t i = 0; i < frame_loc_index_.size(); ++i) {
+        Dimensions_t obsIoIndex = frameStart + frame_loc_index_[i];
+        if (!runStarts.empty() && (runStarts.back() + runCounts.back() == obsIoIndex)) {
+            runCounts.back()++;
+        } else {
+            runStarts.push_back(obsIoIndex);
+            runCounts.push_back(1);
+        }
+    }
+
+    Selection obsIoSelect;
+    obsIoSelect.extent(varShape)
+        .select({ SelectionOperator::SET, 0, runStarts, runCounts });
+    return obsIoSelect;
+}
+
+//------------------------------------------------------------------------------------
+Selection ObsFrameRead::createDirectObsIoSelection(const std::vector<Dimensions_t> & varShape) {
+    // If this process keeps every location in the frame, there is nothing to be gained
+    // from an indexed read so use the simpler contiguous selection.
+    Dimensions_t ownedCount = frame_loc_index_.size();
+    Selection obsIoSelect;
+    if (ownedCount == basicFrameCount("nlocs", frame_start_)) {
+        obsIoSelect = createObsIoSelection(varShape, frame_start_, ownedCount);
+    } else {
+        obsIoSelect = createIndexedObsIoSelection(varShape, frame_start_);
+    }
+    return obsIoSelect;
+}
+
+//------------------------------------------------------------------------------------
+void ObsFrameRead::transferFrameVar(ObsGroup & destFrame, const std::string & varName,
+                                    const Variable & sourceVar, const Dimensions_t frameStart) {
+    Dimensions_t frameCount = this->basicFrameCount(varName, frameStart);
+    if (frameCount > 0) {
+        // Transfer the variable data for this frame. Do this in two steps:
+        //    ObsIo --> memory buffer --> frame storage
+
+        // Selection objects for transfer. Only the dimensions after the first are taken
+        // from the source variable shape by the memory and frame selections, which matters
+        // on the read pool members whose source variables hold the layout of the obs source.
+        std::vector<Dimensions_t> varShape = sourceVar.getDimensions().dimsCur;
+        Selection memBufferSelect = createMemSelection(varShape, frameCount);
+        Selection obsFrameSelect = createEntireFrameSelection(varShape, frameCount);
+
+        // Transfer the data. When using a read pool, only the reader accesses the
+        // backend and the other members of the group receive the data from the reader.
+        Variable destVar = destFrame.vars.open(varName);
+
+        VarUtils::forAnySupportedVariableType(
+              destVar,
+              [&](auto typeDiscriminator) {
+                  typedef decltype(typeDiscriminator) T;
+                  std::vector<T> varValues;
+                  if (is_frame_reader_) {
+                      Selection obsIoSelect =
+                          createObsIoSelection(varShape, frameStart, frameCount);
+                      sourceVar.read<T>(varValues, memBufferSelect, obsIoSelect);
+                  }
+                  if (read_pool_comm_ != nullptr) {
+                      detail::broadcastFrameData(*read_pool_comm_, varValues, 0);
+                  }
+                  destVar.write<T>(varValues, memBufferSelect, obsFrameSelect);
+              },
+              VarUtils::ThrowIfVariableIsOfUnsupportedType(varName));
+    }
+}
+
+//------------------------------------------------------------------------------------
+void ObsFrameRead::readEntireFrame(ObsGroup & destFrame, const Dimensions_t frameStart) {
+    // Resize along the nlocs dimension
+    Variable nlocsVar = destFrame.vars.open("nlocs");
+    destFrame.resize(
+        { std::pair<Variable, Dimensions_t>(nlocsVar, basicFrameCount("nlocs", frameStart)) });
+
+    // Transfer all variable data
+    for (auto & varNameObject : backend_var_list_) {
+        transferFrameVar(destFrame, varNameObject.name, varNameObject.var, frameStart);
+    }
+}
+
+//------------------------------------------------------------------------------------
+void ObsFrameRead::initFromObsSource(const ObsSpaceParameters & params) {
+    // Create the backend engine object. Use the "simulated variables" spec from
+    // the YAML (params.top_level_.simVars) since that is the required spec, thus
+    // the only list guaranteed to be available at this time (ie, before reading
+    // the obs input and constructing the ObsSpace).
+    obs_data_in_ = Engines::ReaderFactory::create(
+        params.top_level_.obsDataIn.value().engine.value().engineParameters,
+        params.windowStart(), params.windowEnd(),
+        params.comm(), params.timeComm(),
+        params.top_level_.simVars.value().variables());
+
+    ObsGroup og = obs_data_in_->getObsGroup();
+
+    // Find out what datetime representation exists in the input
+    // Precedence is epoch first, then string, then offset.
+    use_epoch_datetime_ = og.vars.exists("MetaData/dateTime");
+    use_string_datetime_ = og.vars.exists("MetaData/datetime");
+    use_offset_datetime_ = og.vars.exists("MetaData/time");
+    if (use_epoch_datetime_) {
+      use_string_datetime_ = false;
+      use_offset_datetime_ = false;
+    } else if (use_string_datetime_) {
+      use_offset_datetime_ = false;
+    }
+
+    // Collect information from the backend which will help with frame initialization
+    // and frame looping. Note the call to collectVarDimInfo will cache variable
+    // and dimension information from the backend since doing these on the fly is
+    // very slow with the HDF5 backend.
+    VarUtils::collectVarDimInfo(og, backend_var_list_, backend_dim_var_list_,
+                                backend_dims_attached_to_vars_, backend_max_var_size_);
+    for (auto & varNameObject : backend_var_list_) {
+        backend_var_sizes_[varNameObject.name] =
+            varNameObject.var.getDimensions().dimsCur[0];
+        backend_vars_[varNameObject.name] = varNameObject.var;
+    }
+    for (auto & dimNameObject : backend_dim_var_list_) {
+        backend_var_sizes_[dimNameObject.name] =
+            dimNameObject.var.getDimensions().dimsCur[0];
+        backend_dim_var_names_.insert(dimNameObject.name);
+    }
+
+    // record number of locations from backend
+    backend_nlocs_ = og.vars.open("nlocs").getDimensions().dimsCur[0];
+
+    // Drop the variables that the obsdatain specification asks not to read, keeping
+    // those needed for the location checks, the obs grouping and the MPI distribution
+    setLocationMetadataVars();
+    applyVariableSelection(params.top_level_.obsDataIn.value());
+
+    // Set the number of locations per frame. When a memory budget is given, derive the
+    // frame size from the bytes needed to hold one location of the variables being read.
+    const auto & maxFrameBytes = params.top_level_.obsDataIn.value().maxFrameBytes.value();
+    if (maxFrameBytes != boost::none) {
+        const std::size_t rowBytes = std::max<std::size_t>(frameRowBytes(), 1);
+        max_frame_size_ = std::max<Dimensions_t>(*maxFrameBytes / rowBytes, 1);
+        oops::Log::debug() << "ObsFrameRead: bytes per location: " << rowBytes
+                           << ", frame memory budget: " << *maxFrameBytes << std::endl;
+    } else {
+        max_frame_size_ = params.top_level_.obsDataIn.value().maxFrameSize;
+    }
+}
+
+//------------------------------------------------------------------------------------
+void ObsFrameRead::setLocationMetadataVars() {
+    // Record the variables that are needed for the location checks, the obs grouping and
+    // the MPI distribution. These are read in full for every frame, whereas the remaining
+    // variables dimensioned by nlocs only need to be read for the locations that end up
+    // on this process.
+    location_metadata_vars_.clear();
+    if (use_epoch_datetime_) {
+        location_metadata_vars_.insert("MetaData/dateTime");
+    } else if (use_string_datetime_) {
+        location_metadata_vars_.insert("MetaData/datetime");
+    } else {
+        location_metadata_vars_.insert("MetaData/time");
+    }
+    location_metadata_vars_.insert("MetaData/latitude");
+    location_metadata_vars_.insert("MetaData/longitude");
+    for (auto & obsGroupVarName : obs_grouping_vars_) {
+        location_metadata_vars_.insert(std::string("MetaData/") + obsGroupVarName);
+    }
+}
+
+//------------------------------------------------------------------------------------
+void ObsFrameRead::shareObsSourceLayout(const ObsSpaceParameters & params,
+                                        std::string & sourceSignature) {
+    // The layout only needs the nlocs coordinates of the first frame, both for the frame
+    // container and for the initial size of the ObsSpace container.
+    const Dimensions_t maxNlocs = std::max<Dimensions_t>(
+        max_frame_size_, params.top_level_.obsDataIn.value().maxFrameSize);
+
+    std::vector<char> layout;
+    std::vector<std::string> sourceNames;
+    std::vector<Dimensions_t> sourceSizes;
+    if (is_frame_reader_) {
+        layout = packObsSourceLayout(obs_data_in_->getObsGroup().atts, backend_var_list_,
+                                     backend_dim_var_list_, backend_dims_attached_to_vars_,
+                                     maxNlocs);
+        sourceNames = { obs_data_in_->fileName(), sourceSignature };
+        sourceSizes = { backend_nlocs_, backend_max_var_size_, max_frame_size_,
+                        use_epoch_datetime_, use_string_datetime_, use_offset_datetime_ };
+    }
+    detail::broadcastFrameData<char>(*read_pool_comm_, layout, 0);
+    detail::broadcastFrameData(*read_pool_comm_, sourceNames, 0);
+    detail::broadcastFrameData<Dimensions_t>(*read_pool_comm_, sourceSizes, 0);
+    if (is_frame_reader_) {
+        return;
+    }
+
+    // Set up the members of the group as if they had opened the obs source. The variable
+    // selection has already been applied by the reader.
+    ObsGroup layoutGroup = unpackObsSourceLayout(layout, backend_var_list_,
+                                                 backend_dim_var_list_,
+                                                 backend_dims_attached_to_vars_,
+                                                 backend_var_sizes_);
+    for (auto & varNameObject : backend_var_list_) {
+        backend_vars_[varNameObject.name] = varNameObject.var;
+    }
+    for (auto & dimNameObject : backend_dim_var_list_) {
+        backend_dim_var_names_.insert(dimNameObject.name);
+    }
+    obs_data_in_.reset(new detail::ReadPoolMemberReader(params, layoutGroup, sourceNames[0]));
+    sourceSignature = sourceNames[1];
+    backend_nlocs_ = sourceSizes[0];
+    backend_max_var_size_ = sourceSizes[1];
+    max_frame_size_ = sourceSizes[2];
+    use_epoch_datetime_ = sourceSizes[3];
+    use_string_datetime_ = sourceSizes[4];
+    use_offset_datetime_ = sourceSizes[5];
+    setLocationMetadataVars();
+}
+
+//------------------------------------------------------------------------------------
+void ObsFrameRead::createReadPool(const IoPoolParameters & ioPoolParams) {
+    const eckit::mpi::Comm & comm = params_.comm();
+    const int commSize = comm.size();
+    const int commRank = comm.rank();
+
+    int poolSize = defaultMaxReadPoolSize;
+    if (ioPoolParams.maxPoolSize.value() > 0) {
+        poolSize = ioPoolParams.maxPoolSize.value();
+    }
+
+    // Nothing to be gained if every process would end up being a reader.
+    if (poolSize >= commSize) {
+        oops::Log::debug() << "ObsFrameRead: read pool size (" << poolSize
+                           << ") covers all processes, not using a read pool" << std::endl;
+        return;
+    }
+
+    // Group the ranks in the same manner as IoPool::groupRanks, ie divide the ranks into
+    // poolSize groups of consecutive ranks. The lowest rank in each group is the reader.
+    const int baseGroupSize = commSize / poolSize;
+    const int remGroupSize = commSize % poolSize;
+    int groupNum = 0;
+    int groupStart = 0;
+    for (groupNum = 0; groupNum < poolSize; ++groupNum) {
+        int groupSize = baseGroupSize;
+        if (groupNum < remGroupSize) {
+            groupSize += 1;
+        }
+        if (commRank < groupStart + groupSize) {
+            break;
+        }
+        groupStart += groupSize;
+    }
+
+    read_pool_comm_name_ = readPoolCommName;
+    read_pool_comm_ = &(comm.split(groupNum, read_pool_comm_name_));
+    is_frame_reader_ = (read_pool_comm_->rank() == 0);
+    oops::Log::debug() << "ObsFrameRead: read pool size: " << poolSize << std::endl;
+}
+
+//------------------------------------------------------------------------------------
+void ObsFrameRead::collectGroupFrameLocations() {
+    const int groupSize = read_pool_comm_->size();
+    if (is_frame_reader_) {
+        group_frame_loc_index_.resize(groupSize);
+        group_frame_loc_index_[0] = frame_loc_index_;
+        for (int i = 1; i < groupSize; ++i) {
+            detail::receiveFrameData(*read_pool_comm_, group_frame_loc_index_[i],
+                                     i, readPoolTag);
+        }
+    } else {
+        detail::sendFrameData(*read_pool_comm_, frame_loc_index_, 0, readPoolTag);
+    }
+}
+
+//------------------------------------------------------------------------------------
+void ObsFrameRead::scatterOwnedFrameVar(const std::string & varName,
+                                        const Variable & sourceVar,
+                                        const Dimensions_t frameStart) {
+    Dimensions_t frameCount = this->basicFrameCount(varName, frameStart);
+    if (frameCount > 0) {
+        // The reader transfers the entire frame from the backend into a memory buffer
+        // since the members of the group together typically keep most of the frame. The
+        // rows kept by each member are then copied out of the buffer and sent along.
+        Variable destVar = obs_frame_.vars.open(varName);
+        std::vector<Dimensions_t> varShape = sourceVar.getDimensions().dimsCur;
+        std::vector<Dimensions_t> frameVarShape = destVar.getDimensions().dimsCur;
+        const std::size_t rowSize = std::accumulate(
+            varShape.begin() + 1, varShape.end(), 1, std::multiplies<Dimensions_t>());
+        const int groupSize = read_pool_comm_->size();
+
+        VarUtils::forAnySupportedVariableType(
+              destVar,
+              [&](auto typeDiscriminator) {
+                  typedef decltype(typeDiscriminator) T;
+                  std::vector<T> varValues;
+                  if (is_frame_reader_) {
+                      Selection obsIoSelect =
+                          createObsIoSelection(varShape, frameStart, frameCount);
+                      Selection frameMemSelect = createMemSelection(varShape, frameCount);
+                      std::vector<T> frameValues;
+                      sourceVar.read<T>(frameValues, frameMemSelect, obsIoSelect);
+                      for (int i = 1; i < groupSize; ++i) {
+                          detail::sendFrameData(*read_pool_comm_,
+                              detail::extractFrameRows(frameValues,
+                                                       group_frame_loc_index_[i], rowSize),
+                              i, readPoolTag);
+                      }
+                      varValues = detail::extractFrameRows(frameValues,
+                                                           frame_loc_index_, rowSize);
+                  } else {
+                      detail::receiveFrameData(*read_pool_comm_, varValues, 0, readPoolTag);
+                  }
+
+                  // Place the kept locations back in their original frame rows
+                  Dimensions_t ownedCount = frame_loc_index_.size();
+                  if (ownedCount > 0) {
+                      Selection memBufferSelect = createMemSelection(varShape, ownedCount);
+                      Selection obsFrameSelect = createIndexedFrameSelection(frameVarShape);
+                      destVar.write<T>(varValues, memBufferSelect, obsFrameSelect);
+                  }
+              },
+              VarUtils::ThrowIfVariableIsOfUnsupportedType(varName));
+    }
+}
+
+//------------------------------------------------------------------------------------
+void ObsFrameRead::applyVariableSelection(const ObsDataInParameters & obsDataInParams) {
+    const auto & includeVars = obsDataInParams.includeVariables.value();
+    const auto & excludeVars = obsDataInParams.excludeVariables.value();
+    if ((includeVars == boost::none) && (excludeVars == boost::none)) {
+        return;
+    }
+
+    // Variables needed to construct the ObsSpace are kept regardless of the lists
+    std::set<std::string> requiredVars = location_metadata_vars_;
+    const ObsGroupingParameters & obsGroupingParams = obsDataInParams.obsGrouping.value();
+    if (!obsGroupingParams.obsSortVar.value().empty()) {
+        requiredVars.insert(obsGroupingParams.obsSortGroup.value() + std::string("/") +
+                            obsGroupingParams.obsSortVar.value());
+    }
+
+    VarUtils::Vec_Named_Variable selectedVarList;
+    for (auto & varNameObject : backend_var_list_) {
+        const std::string & varName = varNameObject.name;
+        bool keepVar = true;
+        if (includeVars != boost::none) {
+            keepVar = detail::matchesAnyPattern(varName, *includeVars);
+        }
+        if (keepVar && (excludeVars != boost::none)) {
+            keepVar = !detail::matchesAnyPattern(varName, *excludeVars);
+        }
+        if (keepVar || requiredVars.count(varName)) {
+            selectedVarList.push_back(varNameObject);
+        } else {
+            backend_dims_attached_to_vars_.erase(varNameObject);
+        }
+    }
+    oops::Log::debug() << "ObsFrameRead: reading " << selectedVarList.size() << " of "
+                       << backend_var_list_.size() << " variables from the obs source"
+                       << std::endl;
+    backend_var_list_ = selectedVarList;
+}
+
+//------------------------------------------------------------------------------------
+void ObsFrameRead::convertFrameDatetimes() {
+    if (use_string_datetime_) {
+      // Read in string datetimes and convert to time offsets. Use the window
+      // start time as the epoch.
+      std::vector<std::string> dtStrings;
+      Variable stringDtVar = obs_frame_.vars.open("MetaData/datetime");
+      stringDtVar.read<std::string>(dtStrings);
+      std::vector<int64_t> timeOffsets = convertDtStringsToTimeOffsets(
+          params_.windowStart(), dtStrings);
+
+      // Transfer the epoch datetime to the new variable.
+      Variable epochDtVar = obs_frame_.vars.open("MetaData/dateTime");
+      epochDtVar.write<int64_t>(timeOffsets);
+    } else if (use_offset_datetime_) {
+      // Use the date_time global attribute as the epoch. This means that
+      // we just need to convert the float offset times in hours to an
+      // int64_t offset in seconds.
+      std::vector<float> dtTimeOffsets;
+      Variable offsetDtVar = obs_frame_.vars.open("MetaData/time");
+      offsetDtVar.read<float>(dtTimeOffsets);
+
+      std::vector<int64_t> timeOffsets(dtTimeOffsets.size());
+      for (std::size_t i = 0; i < dtTimeOffsets.size(); ++i) {
+        timeOffsets[i] = static_cast<int64_t>(lround(dtTimeOffsets[i] * 3600.0));
+      }
+
+      // Transfer the epoch datetime to the new variable.
+      Variable epochDtVar = obs_frame_.vars.open("MetaData/dateTime");
+      epochDtVar.write<int64_t>(timeOffsets);
+    }
+}
+
 // -----------------------------------------------------------------------------
 void ObsFrameRead::genFrameIndexRecNums(std::shared_ptr<Distribution> & dist) {
     // Generate location indices relative to the obs source (locIndex) and relative
@@ -385,11 +1129,13 @@ void ObsFrameRead::genFrameLocationsWithQcheck(std::vector<Dimensions_t> & locIn
     Selection memSelect = createMemSelection(varShape, frameCount);
     Selection frameSelect = createEntireFrameSelection(varShape, frameCount);
 
-    // convert ref, offset time to datetime objects
+    // Express the timing window as offsets from the datetime epoch so that the
+    // datetimes can be checked without converting them to DateTime objects.
     std::vector<int64_t> timeOffsets;
     dtVar.read<int64_t>(timeOffsets);
     util::DateTime epochDt = getEpochAsDtime(dtVar);
-    std::vector<util::DateTime> dtimeVals = convertEpochDtToDtime(epochDt, timeOffsets);
+    const int64_t windowStartOffset = (params_.windowStart() - epochDt).toSeconds();
+    const int64_t windowEndOffset = (params_.windowEnd() - epochDt).toSeconds();
 
     // Need to check the latitude and longitude values too.
     std::vector<float> lats;
@@ -404,44 +1150,26 @@ void ObsFrameRead::genFrameLocationsWithQcheck(std::vector<Dimensions_t> & locIn
     detail::FillValueData_t lonFvData = lonVar.getFillValue();
     float lonFillValue = detail::getFillValue<float>(lonFvData);
 
-    // Keep all locations that fall inside the timing window. Note iloc will be set
-    // to the number of locations stored in the output vectors after exiting the
-    // following for loop.
+    // Flag the locations that fall inside the timing window and have valid lat and
+    // lon values. Keep a count of how many obs were rejected due to being outside
+    // the timing window.
+    std::vector<unsigned char> keepFlags(frameCount);
+    std::size_t numInsideWindow = detail::flagLocationsToKeep(
+        timeOffsets.data(), lats.data(), lons.data(), frameCount,
+        windowStartOffset, windowEndOffset, latFillValue, lonFillValue, keepFlags.data());
+    gnlocs_outside_timewindow_ += frameCount - numInsideWindow;
+
+    // Compact the kept locations into the output vectors. Every location is written
+    // and the output position only advances for kept locations, which avoids a branch
+    // per location. Note iloc will be set to the number of locations stored in the
+    // output vectors after exiting the following for loop.
     locIndex.resize(frameCount);
     frameIndex.resize(frameCount);
     std::size_t iloc = 0;
     for (std::size_t i = 0; i < frameCount; ++i) {
-      // Check the timing window first since having a location outside the timing
-      // window likely occurs more than having issues with the lat and lon values.
-      bool keepThisLocation = this->insideTimingWindow(dtimeVals[i]);
-      if (!keepThisLocation) {
-        // Keep a count of how many obs were rejected due to being outside
-        // the timing window
-        gnlocs_outside_timewindow_++;
-      }
-
-      // Check the latitude value if we made it through the timing window check.
-      // Reject the obs if the latitude value is the fill value (missing data)
-      if (keepThisLocation) {
-        if (lats[i] == latFillValue) {
-           keepThisLocation = false;
-        }
-      }
-
-      // Check the longitude value if we made it through the prior checks.
-      // Reject the obs if the longitude value is the fill value (missing data)
-      if (keepThisLocation) {
-        if (lons[i] == lonFillValue) {
-           keepThisLocation = false;
-        }
-      }
-
-      // Obs has passed all of the quality checks so add it to the list of records
-      if (keepThisLocation) {
-        locIndex[iloc] = frameStart + i;
-        frameIndex[iloc] = i;
-        iloc++;
-      }
+      locIndex[iloc] = frameStart + i;
+      frameIndex[iloc] = i;
+      iloc += keepFlags[i];
     }
     locIndex.resize(iloc);
     frameIndex.resize(iloc);
@@ -467,35 +1195,36 @@ void ObsFrameRead::genRecordNumbersGrouping(const std::vector<std::string> & obs
     // Form the selection objects for reading the variables
 
     // Applying obs grouping. First convert all of the group variable data values for this
-    // frame into string key values. This is done in one call to minimize accessing the
+    // frame into key values. This is done in one call to minimize accessing the
     // frame data for the grouping variables.
     std::size_t locSize = frameIndex.size();
     records.assign(locSize, 0);
-    std::vector<std::string> obsGroupingKeys(locSize);
+    ObsGroupingKeys obsGroupingKeys;
     buildObsGroupingKeys(obsGroupVarList, frameIndex, obsGroupingKeys);
 
     for (std::size_t i = 0; i < locSize; ++i) {
-      if (obs_grouping_.find(obsGroupingKeys[i]) == obs_grouping_.end()) {
-        // key is not present in the map
+      std::size_t recNum = obs_grouping_.find(obsGroupingKeys, i);
+      if (recNum == ObsGroupingTable::notFound) {
+        // key is not present in the table
         // assign current record number to the current key, and move to the next record number
-        obs_grouping_.insert(
-            std::pair<std::string, std::size_t>(obsGroupingKeys[i], next_rec_num_));
+        recNum = next_rec_num_;
+        obs_grouping_.insert(obsGroupingKeys, i, recNum);
         next_rec_num_ += rec_num_increment_;
       }
-      records[i] = obs_grouping_.at(obsGroupingKeys[i]);
+      records[i] = recNum;
     }
 }
 
 //------------------------------------------------------------------------------------
 void ObsFrameRead::buildObsGroupingKeys(const std::vector<std::string> & obsGroupVarList,
                                         const std::vector<Dimensions_t> & frameIndex,
-                                        std::vector<std::string> & groupingKeys) {
-    // Walk though each variable and construct the segments of the key values (strings)
+                                        ObsGroupingKeys & groupingKeys) {
+    // Walk though each variable and construct the segments of the key values.
     // Append the segments as each variable is encountered.
+    groupingKeys.reset(frameIndex.size());
     for (std::size_t i = 0; i < obsGroupVarList.size(); ++i) {
-        // Retrieve the variable values from the obs frame and convert
-        // those values to strings. Then append those "value" strings from each
-        // variable to form the grouping keys.
+        // Retrieve the variable values from the obs frame and append them
+        // as segments of the grouping keys.
         std::string obsGroupVarName = obsGroupVarList[i];
         std::string varName = std::string("MetaData/") + obsGroupVarName;
         Variable groupVar = obs_frame_.vars.open(varName);
@@ -521,16 +1250,7 @@ void ObsFrameRead::buildObsGroupingKeys(const std::vector<std::string> & obsGrou
                   std::vector<T> groupVarValues;
                   groupVar.read<T>(groupVarValues, memSelect, frameSelect);
                   groupVarValues.resize(frameCount);
-                  std::string keySegment;
-                  for (std::size_t j = 0; j < frameIndex.size(); ++j) {
-                      keySegment = detail::to_string(groupVarValues[frameIndex[j]]);
-                      if (i == 0) {
-                          groupingKeys[j] = keySegment;
-                      } else {
-                          groupingKeys[j] += ":";
-                          groupingKeys[j] += keySegment;
-                      }
-                  }
+                  detail::appendGroupingKeySegments(groupVarValues, frameIndex, groupingKeys);
               },
               VarUtils::ThrowIfVariableIsOfUnsupportedType(varName));
     }
@@ -570,37 +1290,40 @@ void ObsFrameRead::applyMpiDistribution(const std::shared_ptr<Distribution> & di
     // Generate the index and recnums for this frame.
     const std::size_t commSize = params_.comm().size();
     const std::size_t commRank = params_.comm().rank();
-    std::size_t rowNum = 0;
-    std::size_t recNum = 0;
-    std::size_t frameIndex = 0;
-    std::size_t globalLocIndex = 0;
-    frame_loc_index_.clear();
+    // Assign the records of all the locations in the frame with one call to the
+    // distribution, then keep the locations belonging to records assigned to this PE.
+    std::vector<std::size_t> recNums(records.begin(), records.end());
+    std::vector<std::size_t> globalLocIndices(locIndex.begin(), locIndex.end());
+    std::vector<eckit::geometry::Point2> points;
+    points.reserve(locSize);
     for (std::size_t i = 0; i < locSize; ++i) {
-        rowNum = locIndex[i];
-        recNum = records[i];
         // The current frame storage always starts at zero so frameIndex
         // needs to be the offset from the ObsIo frame start.
-        frameIndex = rowNum - frameStart;
-
-        eckit::geometry::Point2 point(lons[frameIndex], lats[frameIndex]);
-
-        std::size_t globalLocIndex = rowNum;
-        dist_->assignRecord(recNum, globalLocIndex, point);
+        const std::size_t frameIndex = locIndex[i] - frameStart;
+        points.emplace_back(lons[frameIndex], lats[frameIndex]);
+    }
+    std::vector<bool> isMine;
+    if (dist_from_cache_) {
+        // The records have already been assigned by an earlier ObsSpace
+        dist->flagMyRecords(recNums, isMine);
+    } else {
+        dist->assignRecords(recNums, globalLocIndices, points, isMine);
+    }
 
-        if (dist->isMyRecord(recNum)) {
-            indx_.push_back(globalLocIndex);
-            recnums_.push_back(recNum);
-            unique_rec_nums_.insert(recNum);
-            frame_loc_index_.push_back(frameIndex);
+    frame_loc_index_.clear();
+    for (std::size_t i = 0; i < locSize; ++i) {
+        if (isMine[i]) {
+            indx_.push_back(globalLocIndices[i]);
+            recnums_.push_back(recNums[i]);
+            // Consecutive locations usually belong to the same record
+            if (i == 0 || recNums[i] != recNums[i - 1]) {
+                unique_rec_nums_.insert(recNums[i]);
+            }
+            frame_loc_index_.push_back(locIndex[i] - frameStart);
             nlocs_++;
         }
     }
     nrecs_ = unique_rec_nums_.size();
 }
 
-// -----------------------------------------------------------------------------
-bool ObsFrameRead::insideTimingWindow(const util::DateTime & obsDt) {
-    return ((obsDt > params_.windowStart()) && (obsDt <= params_.windowEnd()));
-}
-
 }  // namespace ioda
@@ -8,13 +8,22 @@
 #ifndef IO_OBSFRAMEREAD_H_
 #define IO_OBSFRAMEREAD_H_
 
+#include <functional>
+#include <future>
+#include <map>
+#include <numeric>
+#include <set>
+#include <string>
 #include <vector>
 
 #include "eckit/config/LocalConfiguration.h"
+#include "eckit/mpi/Comm.h"
 
 #include "ioda/core/IodaUtils.h"
 #include "ioda/distribution/Distribution.h"
 #include "ioda/io/ObsFrame.h"
+#include "ioda/io/ObsGroupingTable.h"
+#include "ioda/Io/IoPoolParameters.h"
 #include "ioda/ObsSpaceParameters.h"
 #include "ioda/Variables/VarUtils.h"
 
@@ -99,6 +108,15 @@ class ObsFrameRead : public ObsFrame, private util::ObjectCounter<ObsFrameRead>
     /// \brief return the MPI distribution
     std::shared_ptr<const Distribution> distribution() {return dist_;}
 
+    /// \brief return the backend variables that are not read during the frame loop
+    /// \details When lazy loading is enabled, the variables returned here are skipped
+    /// while walking through the frames. The ObsSpace reads them from the backend,
+    /// for the locations it keeps, the first time they are accessed.
+    std::map<std::string, Variable> lazyLoadVars() const;
+
+    /// \brief return true if the next frame is read ahead on a background thread
+    bool prefetchFrames() const {return prefetch_frames_;}
+
  private:
     //------------------ private data members ------------------------------
 
@@ -112,6 +130,12 @@ class ObsFrameRead : public ObsFrame, private util::ObjectCounter<ObsFrameRead>
     /// \Brief Distribution Name
     std::string distname_;
 
+    /// \brief key of the distribution in the DistributionCache, empty if it is not cached
+    std::string dist_cache_key_;
+
+    /// \brief true if dist_ was taken from the DistributionCache with all records assigned
+    bool dist_from_cache_;
+
     /// \brief current frame start for variable dimensioned along nlocs
     /// \details This data member is keeping track of the frame start for
     /// the contiguous storage where the obs source data will be moved to.
@@ -122,8 +146,8 @@ class ObsFrameRead : public ObsFrame, private util::ObjectCounter<ObsFrameRead>
     /// \brief current frame count for variable dimensioned along nlocs
     Dimensions_t adjusted_nlocs_frame_count_;
 
-    /// \brief map for obs grouping via string keys
-    std::map<std::string, std::size_t> obs_grouping_;
+    /// \brief record numbers assigned to the obs grouping keys seen so far
+    ObsGroupingTable obs_grouping_;
 
     /// \brief indexes of locations to extract from the input obs file
     std::vector<std::size_t> indx_;
@@ -147,29 +171,172 @@ class ObsFrameRead : public ObsFrame, private util::ObjectCounter<ObsFrameRead>
     /// \brief location indices for current frame
     std::vector<Dimensions_t> frame_loc_index_;
 
+    /// \brief names of backend variables needed to select and distribute locations
+    /// \details These variables (datetime, latitude, longitude and the obs grouping
+    /// variables) are read in their entirety for each frame. All other variables
+    /// dimensioned by nlocs are read only for the locations kept on this process.
+    std::set<std::string> location_metadata_vars_;
+
+    /// \brief true if only the locations kept on this process are read from the backend
+    bool read_owned_locations_only_;
+
+    /// \brief names of variables read directly from the backend by readFrameVar
+    /// \details These variables are not transferred into obs_frame_. Instead, the locations
+    /// kept on this process are read from the backend straight into the buffer handed to
+    /// readFrameVar, saving the copy into and out of the frame container.
+    std::set<std::string> direct_read_vars_;
+
+    /// \brief names of variables left for the ObsSpace to read on first access
+    std::set<std::string> lazy_load_vars_;
+
+    /// \brief backend variables indexed by name
+    std::map<std::string, Variable> backend_vars_;
+
+    /// \brief cache for backend selection of variables read directly from the backend
+    std::map<VarUtils::Vec_Named_Variable, Selection> known_obs_io_selections_;
+
+    /// \brief read pool group communicator, nullptr when every process reads for itself
+    /// \details When a read pool is in use, the processes are split into groups of
+    /// consecutive ranks. The first rank of each group (the reader) is the only one that
+    /// reads variable data from the backend. It broadcasts the location metadata to its
+    /// group and sends each member of its group the locations that member keeps.
+    const eckit::mpi::Comm * read_pool_comm_;
+
+    /// \brief name of the read pool group communicator
+    std::string read_pool_comm_name_;
+
+    /// \brief true if this process reads variable data from the backend
+    bool is_frame_reader_;
+
+    /// \brief frame location indices kept by each member of the read pool group
+    /// \details Only filled on the reader, indexed by rank in the read pool group.
+    std::vector<std::vector<Dimensions_t>> group_frame_loc_index_;
+
+    /// \brief true if the next frame is read from the backend on a background thread
+    /// \details In this mode two frame containers are used. While the current frame
+    /// (obs_frame_) is being distributed and handed to the ObsSpace, the next frame is
+    /// read into prefetch_frame_. The two are swapped in frameAvailable.
+    bool prefetch_frames_;
+
+    /// \brief frame container being filled on the background thread
+    ObsGroup prefetch_frame_;
+
+    /// \brief completion of the background read into prefetch_frame_
+    std::future<void> prefetch_future_;
+
+    /// \brief first dimension sizes of the backend variables and dimensions
+    /// \details Cached so that frame counts can be computed without going to the
+    /// backend, which may be busy reading the next frame on the background thread.
+    std::map<std::string, Dimensions_t> backend_var_sizes_;
+
+    /// \brief names of the backend dimension variables
+    std::set<std::string> backend_dim_var_names_;
+
     /// \brief cache for frame selection
     std::map<VarUtils::Vec_Named_Variable, Selection> known_frame_selections_;
 
     /// \brief cache for memory buffer selection
     std::map<VarUtils::Vec_Named_Variable, Selection> known_mem_selections_;
 
+    /// \brief cache for memory buffer selection of variables read directly from the backend
+    /// \details Kept apart from known_mem_selections_ since the dimension lists of the
+    /// backend and of the frame compare equal (by name), and the frame path relies on its
+    /// memory and frame selections being created together.
+    std::map<VarUtils::Vec_Named_Variable, Selection> known_direct_mem_selections_;
+
     //--------------------- private functions ------------------------------
     /// \brief print routine for oops::Printable base class
     /// \param ostream output stream
     void print(std::ostream & os) const override;
 
-    /// \brief return current frame count for variable
+    /// \brief return frame count for variable
     /// \details Variables can be of different sizes so it's possible that the
     /// frame has moved past the end of some variables but not so for other
     /// variables. When the frame is past the end of the given variable, this
     /// routine returns a zero to indicate that we're done with this variable.
-    /// \param var variable
-    Dimensions_t basicFrameCount(const Variable & var);
+    /// \param varName backend variable name
+    /// \param frameStart start of the frame in the backend
+    Dimensions_t basicFrameCount(const std::string & varName,
+                                 const Dimensions_t frameStart) const;
+
+    /// \brief return the number of bytes needed to hold one location of the
+    /// variables being read
+    /// \details Used to derive the frame size from the "max frame bytes" memory budget.
+    std::size_t frameRowBytes() const;
 
     /// \brief set up frontend and backend selection objects for the given variable
     /// \param varShape dimension sizes for variable being transferred
     Selection createIndexedFrameSelection(const std::vector<Dimensions_t> & varShape);
 
+    /// \brief create a backend selection holding only the locations kept on this process
+    /// \details Consecutive entries in frame_loc_index_ are coalesced into runs so that
+    /// the backend sees as few selection blocks as possible.
+    /// \param varShape dimension sizes for variable being transferred
+    /// \param frameStart start of the current frame in the backend
+    Selection createIndexedObsIoSelection(const std::vector<Dimensions_t> & varShape,
+                                          const Dimensions_t frameStart);
+
+    /// \brief create the backend selection for a variable read directly from the backend
+    /// \param varShape dimension sizes for variable being transferred
+    Selection createDirectObsIoSelection(const std::vector<Dimensions_t> & varShape);
+
+    /// \brief transfer an entire frame of a variable from the backend to a frame container
+    /// \param destFrame frame container receiving the data
+    /// \param varName variable name
+    /// \param sourceVar backend variable
+    /// \param frameStart start of the frame in the backend
+    void transferFrameVar(ObsGroup & destFrame, const std::string & varName,
+                          const Variable & sourceVar, const Dimensions_t frameStart);
+
+    /// \brief read an entire frame of all variables from the backend
+    /// \details This is the work done on the background thread when prefetching frames.
+    /// \param destFrame frame container receiving the data
+    /// \param frameStart start of the frame in the backend
+    void readEntireFrame(ObsGroup & destFrame, const Dimensions_t frameStart);
+
+    /// \brief convert string or offset datetimes in the current frame to epoch datetimes
+    void convertFrameDatetimes();
+
+    /// \brief open the obs source and collect the variable and dimension information
+    /// needed for the frame loop
+    /// \param params ObsSpace parameters
+    void initFromObsSource(const ObsSpaceParameters & params);
+
+    /// \brief fill location_metadata_vars_ according to the datetime representation
+    /// and the obs grouping variables
+    void setLocationMetadataVars();
+
+    /// \brief send the layout of the obs source from the reader to the other members of
+    /// its read pool group
+    /// \details The members set up their backend variable and dimension information from
+    /// the layout instead of opening the obs source. The signature of the obs source file
+    /// is sent along for the DistributionCache key.
+    /// \param params ObsSpace parameters
+    /// \param sourceSignature signature of the obs source file (set on the members)
+    void shareObsSourceLayout(const ObsSpaceParameters & params, std::string & sourceSignature);
+
+    /// \brief remove variables from backend_var_list_ according to the include and
+    /// exclude variable lists in the obsdatain specification
+    /// \details The location metadata variables and the sort variable are always kept.
+    /// \param obsDataInParams obsdatain parameters
+    void applyVariableSelection(const ObsDataInParameters & obsDataInParams);
+
+    /// \brief split the processes into read pool groups
+    /// \param ioPoolParams parameters specifying the maximum read pool size
+    void createReadPool(const IoPoolParameters & ioPoolParams);
+
+    /// \brief collect the frame location indices kept by each member of the read
+    /// pool group on the reader
+    void collectGroupFrameLocations();
+
+    /// \brief read the current frame of a variable on the reader and send each member of
+    /// the read pool group the locations it keeps
+    /// \param varName variable name
+    /// \param sourceVar backend variable
+    /// \param frameStart start of the current frame in the backend
+    void scatterOwnedFrameVar(const std::string & varName, const Variable & sourceVar,
+                              const Dimensions_t frameStart);
+
     /// \brief generate frame indices and corresponding record numbers
     /// \details This method generates a list of indices with their corresponding
     ///  record numbers, where the indices denote which locations are to be
@@ -212,13 +379,15 @@ class ObsFrameRead : public ObsFrame, private util::ObjectCounter<ObsFrameRead>
                                   const std::vector<Dimensions_t> & frameIndex,
                                   std::vector<Dimensions_t> & records);
 
-    /// \brief generate string keys for record number assignment
+    /// \brief generate keys for record number assignment
+    /// \details Numeric grouping variables contribute their values as 64-bit key segments
+    /// and string grouping variables contribute their values as string key segments.
     /// \param obsGroupVarList list of variables controlling the grouping function
     /// \param frameIndex vector containing frame location indices
-    /// \param groupingKeys vector of keys for the obs grouping map
+    /// \param groupingKeys keys for the obs grouping table
     void buildObsGroupingKeys(const std::vector<std::string> & obsGroupVarList,
                               const std::vector<Dimensions_t> & frameIndex,
-                              std::vector<std::string> & groupingKeys);
+                              ObsGroupingKeys & groupingKeys);
 
     /// \brief apply MPI distribution
     /// \param dist ioda::Distribution object
@@ -227,10 +396,6 @@ class ObsFrameRead : public ObsFrame, private util::ObjectCounter<ObsFrameRead>
                               const std::vector<Dimensions_t> & locIndex,
                               const std::vector<Dimensions_t> & records);
 
-    /// \details return true if observation is inside the DA timing window.
-    /// \param obsDt Observation date time object
-    bool insideTimingWindow(const util::DateTime & ObsDt);
-
     /// \brief read variable data from frame helper function
     /// \param varName variable name
     /// \param varData varible data
@@ -238,7 +403,10 @@ class ObsFrameRead : public ObsFrame, private util::ObjectCounter<ObsFrameRead>
     bool readFrameVarHelper(const std::string & varName, std::vector<DataType> & varData) {
         bool frameVarAvailable;
         Dimensions_t frameCount = this->frameCount(varName);
-        if (frameCount > 0) {
+        if ((frameCount > 0) && direct_read_vars_.count(varName)) {
+            readDirectFrameVar<DataType>(varName, frameCount, varData);
+            frameVarAvailable = true;
+        } else if (frameCount > 0) {
             Variable frameVar = obs_frame_.vars.open(varName);
             std::vector<Dimensions_t> varShape = frameVar.getDimensions().dimsCur;
 
@@ -274,6 +442,43 @@ class ObsFrameRead : public ObsFrame, private util::ObjectCounter<ObsFrameRead>
         }
         return frameVarAvailable;
     }
+
+    /// \brief read the locations kept on this process directly from the backend
+    /// \param varName variable name
+    /// \param frameCount number of locations kept on this process in the current frame
+    /// \param varData varible data
+    template<typename DataType>
+    void readDirectFrameVar(const std::string & varName, const Dimensions_t frameCount,
+                            std::vector<DataType> & varData) {
+        const Variable & sourceVar = backend_vars_.at(varName);
+        std::vector<Dimensions_t> varShape = sourceVar.getDimensions().dimsCur;
+
+        // Check the cache for the selection
+        VarUtils::Vec_Named_Variable dims;
+        for (auto & ivar : backend_dims_attached_to_vars_) {
+            if (ivar.first.name == varName) {
+                dims = ivar.second;
+                break;
+            }
+        }
+        if (!known_obs_io_selections_.count(dims)) {
+            known_obs_io_selections_[dims] = createDirectObsIoSelection(varShape);
+        }
+        if (!known_direct_mem_selections_.count(dims)) {
+            known_direct_mem_selections_[dims] = createMemSelection(varShape, frameCount);
+        }
+        Selection & memSelect = known_direct_mem_selections_[dims];
+        Selection & obsIoSelect = known_obs_io_selections_[dims];
+
+        // Read the data into the output varData. Size varData to the locations being read
+        // and read through a span, since the vector form of Variable::read would size
+        // varData to hold the entire backend variable.
+        Dimensions_t numElements = std::accumulate(
+            varShape.begin() + 1, varShape.end(), frameCount, std::multiplies<Dimensions_t>());
+        varData.resize(numElements);
+        sourceVar.read<DataType>(gsl::make_span(varData.data(), varData.size()),
+                                 memSelect, obsIoSelect);
+    }
 };
 
 }  // namespace ioda
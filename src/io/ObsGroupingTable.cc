@@ -0,0 +1,183 @@
+/*
+ * (C) Copyright 2022 UCAR
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ */
+
+#include "ioda/io/ObsGroupingTable.h"
+
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <utility>
+
+#include "ioda/Exception.h"
+
+namespace ioda {
+
+namespace {
+  /// Mix a key segment into a running hash (splitmix64 finalizer).
+  std::uint64_t combineHash(const std::uint64_t seed, const std::uint64_t value) {
+    std::uint64_t x = seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  /// Initial number of slots in the hash table, must be a power of two.
+  constexpr std::size_t initialNumSlots = 1024;
+}  // namespace
+
+//------------------------------------------------------------------------------------
+std::uint64_t groupingKeySegment(const int64_t value) {
+    return static_cast<std::uint64_t>(value);
+}
+
+std::uint64_t groupingKeySegment(const int value) {
+    return groupingKeySegment(static_cast<int64_t>(value));
+}
+
+std::uint64_t groupingKeySegment(const char value) {
+    return groupingKeySegment(static_cast<int64_t>(value));
+}
+
+//------------------------------------------------------------------------------------
+std::uint64_t groupingKeySegment(const float value) {
+    // Scaling a float by 1.0e6 in double precision is exact, and std::nearbyint rounds
+    // half to even like the printf conversion does. The sign of values that round to zero
+    // is kept since those print as "-0.000000", and NaNs only keep their sign.
+    double rounded;
+    if (std::isnan(value)) {
+        rounded = std::copysign(std::numeric_limits<double>::quiet_NaN(), value);
+    } else {
+        rounded = std::nearbyint(static_cast<double>(value) * 1.0e6);
+    }
+    std::uint64_t segment;
+    std::memcpy(&segment, &rounded, sizeof(segment));
+    return segment;
+}
+
+//------------------------------------------------------------------------------------
+void ObsGroupingKeys::reset(const std::size_t numLocs) {
+    num_locs_ = numLocs;
+    num_numeric_segments_ = 0;
+    num_string_segments_ = 0;
+    hashes_.assign(numLocs, 0);
+    numeric_segments_.clear();
+    string_segments_.clear();
+}
+
+//------------------------------------------------------------------------------------
+void ObsGroupingKeys::appendNumericSegments(const std::vector<std::uint64_t> & segments) {
+    for (std::size_t i = 0; i < num_locs_; ++i) {
+        hashes_[i] = combineHash(hashes_[i], segments[i]);
+    }
+    numeric_segments_.insert(numeric_segments_.end(), segments.begin(), segments.end());
+    num_numeric_segments_++;
+}
+
+//------------------------------------------------------------------------------------
+void ObsGroupingKeys::appendStringSegments(std::vector<std::string> && segments) {
+    std::hash<std::string> stringHash;
+    for (std::size_t i = 0; i < num_locs_; ++i) {
+        hashes_[i] = combineHash(hashes_[i], stringHash(segments[i]));
+    }
+    string_segments_.insert(string_segments_.end(),
+                            std::make_move_iterator(segments.begin()),
+                            std::make_move_iterator(segments.end()));
+    num_string_segments_++;
+}
+
+//------------------------------------------------------------------------------------
+constexpr std::size_t ObsGroupingTable::notFound;
+
+//------------------------------------------------------------------------------------
+std::size_t ObsGroupingTable::find(const ObsGroupingKeys & keys, const std::size_t iloc) const {
+    if (slots_.empty()) {
+        return notFound;
+    }
+    const std::uint64_t keyHash = keys.hash(iloc);
+    const std::size_t slotMask = slots_.size() - 1;
+    for (std::size_t islot = keyHash & slotMask; ; islot = (islot + 1) & slotMask) {
+        const std::size_t slot = slots_[islot];
+        if (slot == 0) {
+            return notFound;
+        }
+        const std::size_t ientry = slot - 1;
+        if ((entry_hashes_[ientry] == keyHash) && keyMatches(ientry, keys, iloc)) {
+            return entry_rec_nums_[ientry];
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------
+void ObsGroupingTable::insert(const ObsGroupingKeys & keys, const std::size_t iloc,
+                              const std::size_t recNum) {
+    if (entry_rec_nums_.empty()) {
+        num_numeric_segments_ = keys.numNumericSegments();
+        num_string_segments_ = keys.numStringSegments();
+    } else if ((keys.numNumericSegments() != num_numeric_segments_) ||
+               (keys.numStringSegments() != num_string_segments_)) {
+        throw Exception("ObsGroupingTable: key layout does not match the keys in the table",
+                        ioda_Here());
+    }
+
+    // Keep the load factor at or below one half
+    if (2 * (entry_rec_nums_.size() + 1) > slots_.size()) {
+        grow();
+    }
+
+    const std::size_t ientry = entry_rec_nums_.size();
+    entry_hashes_.push_back(keys.hash(iloc));
+    for (std::size_t iseg = 0; iseg < num_numeric_segments_; ++iseg) {
+        entry_numeric_segments_.push_back(keys.numericSegment(iseg, iloc));
+    }
+    for (std::size_t iseg = 0; iseg < num_string_segments_; ++iseg) {
+        entry_string_segments_.push_back(keys.stringSegment(iseg, iloc));
+    }
+    entry_rec_nums_.push_back(recNum);
+    placeEntry(ientry);
+}
+
+//------------------------------------------------------------------------------------
+bool ObsGroupingTable::keyMatches(const std::size_t ientry, const ObsGroupingKeys & keys,
+                                  const std::size_t iloc) const {
+    const std::uint64_t * entryNumeric =
+        entry_numeric_segments_.data() + ientry * num_numeric_segments_;
+    for (std::size_t iseg = 0; iseg < num_numeric_segments_; ++iseg) {
+        if (entryNumeric[iseg] != keys.numericSegment(iseg, iloc)) {
+            return false;
+        }
+    }
+    const std::string * entryString =
+        entry_string_segments_.data() + ientry * num_string_segments_;
+    for (std::size_t iseg = 0; iseg < num_string_segments_; ++iseg) {
+        if (entryString[iseg] != keys.stringSegment(iseg, iloc)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------------
+void ObsGroupingTable::placeEntry(const std::size_t ientry) {
+    const std::size_t slotMask = slots_.size() - 1;
+    std::size_t islot = entry_hashes_[ientry] & slotMask;
+    while (slots_[islot] != 0) {
+        islot = (islot + 1) & slotMask;
+    }
+    slots_[islot] = ientry + 1;
+}
+
+//------------------------------------------------------------------------------------
+void ObsGroupingTable::grow() {
+    const std::size_t numSlots = slots_.empty() ? initialNumSlots : 2 * slots_.size();
+    slots_.assign(numSlots, 0);
+    for (std::size_t ientry = 0; ientry < entry_rec_nums_.size(); ++ientry) {
+        placeEntry(ientry);
+    }
+}
+
+}  // namespace ioda
@@ -0,0 +1,153 @@
+/*
+ * (C) Copyright 2022 UCAR
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ */
+
+#ifndef IO_OBSGROUPINGTABLE_H_
+#define IO_OBSGROUPINGTABLE_H_
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace ioda {
+
+/// \brief return the obs grouping key segment for an integer value
+/// \details Integer values are widened to 64 bits so that equal values give equal
+/// segments regardless of the variable type.
+std::uint64_t groupingKeySegment(const int64_t value);
+std::uint64_t groupingKeySegment(const int value);
+std::uint64_t groupingKeySegment(const char value);
+
+/// \brief return the obs grouping key segment for a float value
+/// \details Float values have always been grouped by their std::to_string form, which
+/// prints six decimal places. To keep the same record numbering, the value is rounded
+/// to a multiple of 1.0e-6 the same way and the bits of the rounded double are used.
+std::uint64_t groupingKeySegment(const float value);
+
+/// \brief Obs grouping keys for the locations of one frame
+/// \details A key is made of one segment per obs grouping variable. Numeric variables
+/// contribute a 64-bit segment and string variables contribute a string segment.
+/// The segments are stored one grouping variable after the other so that they can be
+/// appended as each grouping variable is read. A hash of the segments is kept up to
+/// date for every location.
+class ObsGroupingKeys {
+ public:
+    /// \brief discard the current keys and start a new set
+    /// \param numLocs number of locations
+    void reset(const std::size_t numLocs);
+
+    /// \brief append the segments of a numeric obs grouping variable
+    /// \param segments one segment per location
+    void appendNumericSegments(const std::vector<std::uint64_t> & segments);
+
+    /// \brief append the segments of a string obs grouping variable
+    /// \param segments one segment per location
+    void appendStringSegments(std::vector<std::string> && segments);
+
+    /// \brief return the number of locations
+    std::size_t numLocs() const {return num_locs_;}
+
+    /// \brief return the number of numeric segments in each key
+    std::size_t numNumericSegments() const {return num_numeric_segments_;}
+
+    /// \brief return the number of string segments in each key
+    std::size_t numStringSegments() const {return num_string_segments_;}
+
+    /// \brief return the hash of the key for a location
+    std::uint64_t hash(const std::size_t iloc) const {return hashes_[iloc];}
+
+    /// \brief return a numeric segment of the key for a location
+    std::uint64_t numericSegment(const std::size_t iseg, const std::size_t iloc) const {
+        return numeric_segments_[iseg * num_locs_ + iloc];
+    }
+
+    /// \brief return a string segment of the key for a location
+    const std::string & stringSegment(const std::size_t iseg, const std::size_t iloc) const {
+        return string_segments_[iseg * num_locs_ + iloc];
+    }
+
+ private:
+    /// \brief number of locations
+    std::size_t num_locs_ = 0;
+
+    /// \brief number of numeric segments in each key
+    std::size_t num_numeric_segments_ = 0;
+
+    /// \brief number of string segments in each key
+    std::size_t num_string_segments_ = 0;
+
+    /// \brief hash of the key for each location
+    std::vector<std::uint64_t> hashes_;
+
+    /// \brief numeric segments, grouping variable major
+    std::vector<std::uint64_t> numeric_segments_;
+
+    /// \brief string segments, grouping variable major
+    std::vector<std::string> string_segments_;
+};
+
+/// \brief Hash table mapping obs grouping keys to record numbers
+/// \details The table uses open addressing with linear probing. The keys are copied
+/// into flat per-entry storage when they are inserted, so the ObsGroupingKeys object
+/// used for the insertion does not need to outlive the call.
+class ObsGroupingTable {
+ public:
+    /// \brief returned by find when the key is not in the table
+    static constexpr std::size_t notFound = std::numeric_limits<std::size_t>::max();
+
+    /// \brief return the record number assigned to the key of a location
+    /// \param keys grouping keys
+    /// \param iloc location index into keys
+    /// \return record number, or notFound if the key is not in the table
+    std::size_t find(const ObsGroupingKeys & keys, const std::size_t iloc) const;
+
+    /// \brief add the key of a location to the table
+    /// \details The key must not already be in the table.
+    /// \param keys grouping keys
+    /// \param iloc location index into keys
+    /// \param recNum record number assigned to the key
+    void insert(const ObsGroupingKeys & keys, const std::size_t iloc, const std::size_t recNum);
+
+    /// \brief return the number of keys in the table
+    std::size_t size() const {return entry_rec_nums_.size();}
+
+ private:
+    /// \brief number of numeric segments in each key
+    std::size_t num_numeric_segments_ = 0;
+
+    /// \brief number of string segments in each key
+    std::size_t num_string_segments_ = 0;
+
+    /// \brief hash table slots holding an entry index plus one, zero for an empty slot
+    std::vector<std::size_t> slots_;
+
+    /// \brief hash of the key of each entry
+    std::vector<std::uint64_t> entry_hashes_;
+
+    /// \brief numeric segments of each entry, entry major
+    std::vector<std::uint64_t> entry_numeric_segments_;
+
+    /// \brief string segments of each entry, entry major
+    std::vector<std::string> entry_string_segments_;
+
+    /// \brief record number of each entry
+    std::vector<std::size_t> entry_rec_nums_;
+
+    /// \brief true if the key of an entry matches the key of a location
+    bool keyMatches(const std::size_t ientry, const ObsGroupingKeys & keys,
+                    const std::size_t iloc) const;
+
+    /// \brief place an entry in the first free slot of its probe sequence
+    void placeEntry(const std::size_t ientry);
+
+    /// \brief double the number of slots and re-place all entries
+    void grow();
+};
+
+}  // namespace ioda
+
+#endif  // IO_OBSGROUPINGTABLE_H_
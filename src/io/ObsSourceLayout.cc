@@ -0,0 +1,377 @@
+/*
+ * (C) Copyright 2022 UCAR
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ */
+
+#include "ioda/io/ObsSourceLayout.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include "ioda/Attributes/Attribute.h"
+#include "ioda/Engines/EngineUtils.h"
+#include "ioda/Engines/HH.h"
+#include "ioda/Exception.h"
+#include "ioda/Variables/Fill.h"
+#include "ioda/Variables/Variable.h"
+
+namespace ioda {
+
+namespace {
+  /// Codes identifying the types of the variables and attributes in a packed layout.
+  enum class LayoutType : int {
+    Int = 0,
+    Int64 = 1,
+    Float = 2,
+    String = 3,
+    Char = 4,
+    Long = 5,
+    Double = 6,
+    Unsupported = -1
+  };
+
+  /// Writes the items of a layout one after the other into a buffer.
+  class LayoutWriter {
+   public:
+    template <typename T>
+    void put(const T & value) {
+      const char * bytes = reinterpret_cast<const char *>(&value);
+      buffer_.insert(buffer_.end(), bytes, bytes + sizeof(T));
+    }
+
+    void put(const std::string & value) {
+      put<std::size_t>(value.size());
+      buffer_.insert(buffer_.end(), value.begin(), value.end());
+    }
+
+    template <typename T>
+    void put(const std::vector<T> & values) {
+      put<std::size_t>(values.size());
+      for (auto & value : values) {
+        put(value);
+      }
+    }
+
+    std::vector<char> & buffer() { return buffer_; }
+
+   private:
+    std::vector<char> buffer_;
+  };
+
+  /// Reads the items of a layout in the order they were written by LayoutWriter.
+  class LayoutReader {
+   public:
+    explicit LayoutReader(const std::vector<char> & buffer) : buffer_(buffer), pos_(0) {}
+
+    template <typename T>
+    void get(T & value) {
+      checkAvailable(sizeof(T));
+      std::memcpy(&value, buffer_.data() + pos_, sizeof(T));
+      pos_ += sizeof(T);
+    }
+
+    void get(std::string & value) {
+      std::size_t size;
+      get(size);
+      checkAvailable(size);
+      value.assign(buffer_.data() + pos_, size);
+      pos_ += size;
+    }
+
+    template <typename T>
+    void get(std::vector<T> & values) {
+      std::size_t size;
+      get(size);
+      values.resize(size);
+      for (auto & value : values) {
+        get(value);
+      }
+    }
+
+   private:
+    void checkAvailable(const std::size_t numBytes) const {
+      if (pos_ + numBytes > buffer_.size()) {
+        throw Exception("Obs source layout is truncated", ioda_Here());
+      }
+    }
+
+    const std::vector<char> & buffer_;
+    std::size_t pos_;
+  };
+
+  template <typename T> LayoutType layoutType();
+  template <> LayoutType layoutType<int>() { return LayoutType::Int; }
+  template <> LayoutType layoutType<int64_t>() { return LayoutType::Int64; }
+  template <> LayoutType layoutType<float>() { return LayoutType::Float; }
+  template <> LayoutType layoutType<std::string>() { return LayoutType::String; }
+  template <> LayoutType layoutType<char>() { return LayoutType::Char; }
+
+  /// Call action with a default constructed value of the type identified by typeCode.
+  template <typename Action>
+  void switchOnLayoutType(const LayoutType typeCode, const Action & action) {
+    switch (typeCode) {
+      case LayoutType::Int: action(int()); break;
+      case LayoutType::Int64: action(int64_t()); break;
+      case LayoutType::Float: action(float()); break;
+      case LayoutType::String: action(std::string()); break;
+      case LayoutType::Char: action(char()); break;
+      case LayoutType::Long: action(long()); break;      // NOLINT
+      case LayoutType::Double: action(double()); break;
+      default:
+        throw Exception("Unexpected type code in the obs source layout", ioda_Here());
+    }
+  }
+
+  /// Return the type code of an attribute, or LayoutType::Unsupported for the types
+  /// copyAttributes does not handle either (eg, the references of dimension lists).
+  LayoutType attributeType(const Attribute & attr) {
+    if (attr.isA<int>()) return LayoutType::Int;
+    if (attr.isA<long>()) return LayoutType::Long;    // NOLINT
+    if (attr.isA<float>()) return LayoutType::Float;
+    if (attr.isA<double>()) return LayoutType::Double;
+    if (attr.isA<std::string>()) return LayoutType::String;
+    if (attr.isA<char>()) return LayoutType::Char;
+    return LayoutType::Unsupported;
+  }
+
+  void packAttributes(const Has_Attributes & atts, LayoutWriter & writer) {
+    std::vector<std::pair<std::string, Attribute>> packedAtts;
+    for (auto & namedAttr : atts.openAll()) {
+      if (attributeType(namedAttr.second) != LayoutType::Unsupported) {
+        packedAtts.push_back(namedAttr);
+      }
+    }
+    writer.put<std::size_t>(packedAtts.size());
+    for (auto & namedAttr : packedAtts) {
+      const Attribute & attr = namedAttr.second;
+      const LayoutType typeCode = attributeType(attr);
+      writer.put(namedAttr.first);
+      writer.put(typeCode);
+      writer.put(attr.getDimensions().dimsCur);
+      switchOnLayoutType(typeCode, [&](auto typeDiscriminator) {
+        typedef decltype(typeDiscriminator) T;
+        std::vector<T> values(attr.getDimensions().numElements);
+        attr.read<T>(gsl::make_span(values));
+        writer.put(values);
+      });
+    }
+  }
+
+  void unpackAttributes(LayoutReader & reader, Has_Attributes & atts) {
+    std::size_t numAtts;
+    reader.get(numAtts);
+    for (std::size_t i = 0; i < numAtts; ++i) {
+      std::string attrName;
+      LayoutType typeCode;
+      std::vector<Dimensions_t> attrDims;
+      reader.get(attrName);
+      reader.get(typeCode);
+      reader.get(attrDims);
+      switchOnLayoutType(typeCode, [&](auto typeDiscriminator) {
+        typedef decltype(typeDiscriminator) T;
+        std::vector<T> values;
+        reader.get(values);
+        if (!atts.exists(attrName)) {
+          atts.add<T>(attrName, gsl::make_span(values), attrDims);
+        }
+      });
+    }
+  }
+
+  /// Read the first numCoords coordinate values of a dimension.
+  template <typename T>
+  std::vector<T> readDimCoords(const Variable & dimVar, const Dimensions_t dimSize,
+                               const Dimensions_t numCoords) {
+    std::vector<T> coords(numCoords);
+    if (numCoords > 0) {
+      std::vector<Dimensions_t> starts(1, 0);
+      std::vector<Dimensions_t> counts(1, numCoords);
+      Selection srcSelect;
+      srcSelect.extent(std::vector<Dimensions_t>(1, dimSize))
+          .select({ SelectionOperator::SET, starts, counts });
+      Selection memSelect;
+      memSelect.extent(counts).select({ SelectionOperator::SET, starts, counts });
+      dimVar.read<T>(gsl::make_span(coords), memSelect, srcSelect);
+    }
+    return coords;
+  }
+
+  /// Return the number of coordinate values of a dimension that are held in the layout.
+  Dimensions_t layoutDimSize(const std::string & dimName, const Dimensions_t dimSize,
+                             const Dimensions_t maxNlocs) {
+    return (dimName == "nlocs") ? std::min(dimSize, maxNlocs) : dimSize;
+  }
+}  // namespace
+
+//------------------------------------------------------------------------------------
+std::vector<char> packObsSourceLayout(const Has_Attributes & globalAtts,
+                                      const VarUtils::Vec_Named_Variable & varList,
+                                      const VarUtils::Vec_Named_Variable & dimVarList,
+                                      const VarUtils::VarDimMap & dimsAttachedToVars,
+                                      const Dimensions_t maxNlocs) {
+    LayoutWriter writer;
+    packAttributes(globalAtts, writer);
+
+    // Dimensions: the sizes first since they are all needed to create the dimension
+    // scales, then the coordinate values and attributes.
+    writer.put<std::size_t>(dimVarList.size());
+    for (auto & dimNameObject : dimVarList) {
+        const Variable & dimVar = dimNameObject.var;
+        const LayoutType typeCode = dimVar.isA<int>() ? LayoutType::Int : LayoutType::Float;
+        const Dimensions_t dimSize = dimVar.getDimensions().dimsCur[0];
+        writer.put(dimNameObject.name);
+        writer.put(typeCode);
+        writer.put(dimSize);
+        writer.put(layoutDimSize(dimNameObject.name, dimSize, maxNlocs));
+    }
+    for (auto & dimNameObject : dimVarList) {
+        const Variable & dimVar = dimNameObject.var;
+        const Dimensions_t dimSize = dimVar.getDimensions().dimsCur[0];
+        const Dimensions_t numCoords = layoutDimSize(dimNameObject.name, dimSize, maxNlocs);
+        if (dimVar.isA<int>()) {
+            writer.put(readDimCoords<int>(dimVar, dimSize, numCoords));
+        } else {
+            writer.put(readDimCoords<float>(dimVar, dimSize, numCoords));
+        }
+        packAttributes(dimVar.atts, writer);
+    }
+
+    // Variables
+    writer.put<std::size_t>(varList.size());
+    for (auto & varNameObject : varList) {
+        const Variable & var = varNameObject.var;
+        std::vector<std::string> dimNames;
+        for (auto & dimNameObject : dimsAttachedToVars.at(varNameObject)) {
+            dimNames.push_back(dimNameObject.name);
+        }
+        writer.put(varNameObject.name);
+        writer.put(var.getDimensions().dimsCur[0]);
+        VarUtils::forAnySupportedVariableType(
+            var,
+            [&](auto typeDiscriminator) {
+                typedef decltype(typeDiscriminator) T;
+                writer.put(layoutType<T>());
+                writer.put(dimNames);
+                const int hasFillValue = var.hasFillValue();
+                writer.put(hasFillValue);
+                if (hasFillValue) {
+                    writer.put(ioda::detail::getFillValue<T>(var.getFillValue()));
+                }
+            },
+            VarUtils::ThrowIfVariableIsOfUnsupportedType(varNameObject.name));
+        packAttributes(var.atts, writer);
+    }
+    return std::move(writer.buffer());
+}
+
+//------------------------------------------------------------------------------------
+ObsGroup unpackObsSourceLayout(const std::vector<char> & layout,
+                               VarUtils::Vec_Named_Variable & varList,
+                               VarUtils::Vec_Named_Variable & dimVarList,
+                               VarUtils::VarDimMap & dimsAttachedToVars,
+                               std::map<std::string, Dimensions_t> & varSizes) {
+    LayoutReader reader(layout);
+    varList.clear();
+    dimVarList.clear();
+    dimsAttachedToVars.clear();
+    varSizes.clear();
+
+    // Global attributes are added once the group exists
+    Engines::BackendCreationParameters backendParams;
+    backendParams.action = Engines::BackendFileActions::Create;
+    backendParams.createMode = Engines::BackendCreateModes::Truncate_If_Exists;
+    backendParams.fileName = ioda::Engines::HH::genUniqueName();
+    backendParams.allocBytes = 1024*1024*50;
+    backendParams.flush = false;
+    Group backend = constructBackend(Engines::BackendNames::ObsStore, backendParams);
+    unpackAttributes(reader, backend.atts);
+
+    // Dimensions. The nlocs dimension is only as large as the coordinate values held in
+    // the layout, the size in the obs source is returned in varSizes.
+    std::size_t numDims;
+    reader.get(numDims);
+    std::vector<std::string> dimNames(numDims);
+    NewDimensionScales_t newDims;
+    for (std::size_t i = 0; i < numDims; ++i) {
+        LayoutType typeCode;
+        Dimensions_t dimSize;
+        Dimensions_t layoutSize;
+        reader.get(dimNames[i]);
+        reader.get(typeCode);
+        reader.get(dimSize);
+        reader.get(layoutSize);
+        varSizes[dimNames[i]] = dimSize;
+        if (typeCode == LayoutType::Int) {
+            newDims.push_back(ioda::NewDimensionScale<int>(
+                dimNames[i], layoutSize, layoutSize, layoutSize));
+        } else {
+            newDims.push_back(ioda::NewDimensionScale<float>(
+                dimNames[i], layoutSize, layoutSize, layoutSize));
+        }
+    }
+    ObsGroup layoutGroup = ObsGroup::generate(backend, newDims);
+    for (std::size_t i = 0; i < numDims; ++i) {
+        Variable dimVar = layoutGroup.vars.open(dimNames[i]);
+        if (dimVar.isA<int>()) {
+            std::vector<int> coords;
+            reader.get(coords);
+            if (!coords.empty()) {
+                dimVar.write<int>(coords);
+            }
+        } else {
+            std::vector<float> coords;
+            reader.get(coords);
+            if (!coords.empty()) {
+                dimVar.write<float>(coords);
+            }
+        }
+        unpackAttributes(reader, dimVar.atts);
+        dimVarList.push_back(Named_Variable{dimNames[i], dimVar});
+    }
+
+    // Variables
+    std::size_t numVars;
+    reader.get(numVars);
+    for (std::size_t i = 0; i < numVars; ++i) {
+        std::string varName;
+        Dimensions_t varSize;
+        LayoutType typeCode;
+        std::vector<std::string> varDimNames;
+        int hasFillValue;
+        reader.get(varName);
+        reader.get(varSize);
+        varSizes[varName] = varSize;
+        reader.get(typeCode);
+        reader.get(varDimNames);
+        reader.get(hasFillValue);
+
+        std::vector<Variable> dimVars;
+        VarUtils::Vec_Named_Variable varDims;
+        for (auto & dimName : varDimNames) {
+            dimVars.push_back(layoutGroup.vars.open(dimName));
+            varDims.push_back(Named_Variable{dimName, dimVars.back()});
+        }
+        Variable var;
+        switchOnLayoutType(typeCode, [&](auto typeDiscriminator) {
+            typedef decltype(typeDiscriminator) T;
+            VariableCreationParameters params;
+            if (hasFillValue) {
+                T fillValue;
+                reader.get(fillValue);
+                params.setFillValue<T>(fillValue);
+            }
+            var = layoutGroup.vars.createWithScales<T>(varName, dimVars, params);
+        });
+        unpackAttributes(reader, var.atts);
+        Named_Variable varNameObject{varName, var};
+        varList.push_back(varNameObject);
+        dimsAttachedToVars.emplace(varNameObject, varDims);
+    }
+    return layoutGroup;
+}
+
+}  // namespace ioda
@@ -0,0 +1,55 @@
+/*
+ * (C) Copyright 2022 UCAR
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ */
+
+#ifndef IO_OBSSOURCELAYOUT_H_
+#define IO_OBSSOURCELAYOUT_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ioda/Misc/Dimensions.h"
+#include "ioda/ObsGroup.h"
+#include "ioda/Variables/VarUtils.h"
+
+namespace ioda {
+
+/// \brief pack the layout of an obs source into a buffer
+/// \details The layout holds the global attributes, the dimensions (type, size and
+/// coordinate values) and the variables (size, type, attached dimensions, fill value and
+/// attributes) but not the variable data. It is used by the readers of a read pool to
+/// describe the obs source to the processes of their group that do not open it.
+/// Only the first maxNlocs coordinate values of the nlocs dimension are packed.
+/// \param globalAtts global attributes of the obs source
+/// \param varList variables of the obs source, in the order they are processed
+/// \param dimVarList dimensions of the obs source, in the order they are processed
+/// \param dimsAttachedToVars dimensions attached to each variable
+/// \param maxNlocs maximum number of nlocs coordinate values to pack
+std::vector<char> packObsSourceLayout(const Has_Attributes & globalAtts,
+                                      const VarUtils::Vec_Named_Variable & varList,
+                                      const VarUtils::Vec_Named_Variable & dimVarList,
+                                      const VarUtils::VarDimMap & dimsAttachedToVars,
+                                      const Dimensions_t maxNlocs);
+
+/// \brief create an in-memory obs group from a layout packed by packObsSourceLayout
+/// \details The nlocs dimension of the group only holds the coordinate values that were
+/// packed, so that no memory is spent on the entire obs source. The sizes along the first
+/// dimension of the variables and dimensions in the obs source are returned in varSizes.
+/// \param layout packed layout
+/// \param varList variables of the new group, in the order they were packed
+/// \param dimVarList dimensions of the new group, in the order they were packed
+/// \param dimsAttachedToVars dimensions attached to each variable of the new group
+/// \param varSizes sizes of the variables and dimensions in the obs source
+ObsGroup unpackObsSourceLayout(const std::vector<char> & layout,
+                               VarUtils::Vec_Named_Variable & varList,
+                               VarUtils::Vec_Named_Variable & dimVarList,
+                               VarUtils::VarDimMap & dimsAttachedToVars,
+                               std::map<std::string, Dimensions_t> & varSizes);
+
+}  // namespace ioda
+
+#endif  // IO_OBSSOURCELAYOUT_H_
@@ -102,9 +102,14 @@ void testDistribution(const eckit::Configuration &config,
   std::vector<bool> patchBool(Index.size());
   std::vector<std::size_t> PatchLocsThisPE;
   TestDist->patchObs(patchBool);
+  std::vector<std::size_t> PatchObsIndices;
   for (std::size_t j = 0; j < Index.size(); ++j) {
-    if (patchBool[j]) {PatchLocsThisPE.push_back(Index[j]);}
+    if (patchBool[j]) {
+      PatchLocsThisPE.push_back(Index[j]);
+      PatchObsIndices.push_back(j);
+    }
   }
+  EXPECT_EQUAL(TestDist->patchObsIndices(Index.size()), PatchObsIndices);
 
   // Check the location and record counts
   std::size_t Nlocs = Index.size();
@@ -276,12 +281,81 @@ void testDistributionConstructedManually() {
     }
     TestDist->computePatchLocs();
 
+    // Assigning all records with a single batched call should keep the same locations.
+    std::unique_ptr<ioda::Distribution> BatchDist =
+                    DistributionFactory::create(MpiComm, params.params);
+    std::vector<std::size_t> GlobalLocs(Gnlocs);
+    std::iota(GlobalLocs.begin(), GlobalLocs.end(), 0);
+    std::vector<eckit::geometry::Point2> Points;
+    for (std::size_t j = 0; j < Gnlocs; ++j)
+      Points.emplace_back(glons[j], glats[j]);
+    std::vector<bool> IsMine;
+    BatchDist->assignRecords(Groups, GlobalLocs, Points, IsMine);
+    std::vector<std::size_t> BatchIndex;
+    for (std::size_t j = 0; j < Gnlocs; ++j)
+      if (IsMine[j])
+        BatchIndex.push_back(j);
+    EXPECT(BatchIndex == Index);
+
     testDistribution(dist_types[i], MyRankConfig, TestDist.get(), Index, Recnums);
   }    // loop distributions
 }      // testDistributionConstructedManually
 
 // -----------------------------------------------------------------------------
 
+// Assigns the locations of a regular longitude-latitude grid covering a small region, each in
+// its own record, with a single call to assignRecords() and checks that the numbers of
+// locations held on the process elements differ from their mean by at most the given fraction.
+void testDistributionBalance() {
+  const eckit::LocalConfiguration conf(::test::TestEnvironment::config());
+  if (!conf.has("balance tests"))
+    return;
+
+  const eckit::mpi::Comm & MpiComm = oops::mpi::world();
+
+  for (const eckit::LocalConfiguration & testConf : conf.getSubConfigurations("balance tests")) {
+    oops::Log::debug() << "Distribution::BalanceTests: conf: " << testConf << std::endl;
+
+    const eckit::LocalConfiguration DistConfig(testConf, "config.distribution");
+    DistributionParametersWrapper params;
+    params.validateAndDeserialize(DistConfig);
+    std::unique_ptr<ioda::Distribution> TestDist =
+                    DistributionFactory::create(MpiComm, params.params);
+
+    const std::vector<double> lonRange = testConf.getDoubleVector("longitude range");
+    const std::vector<double> latRange = testConf.getDoubleVector("latitude range");
+    const std::vector<std::size_t> gridSize = testConf.getUnsignedVector("grid size");
+    std::vector<eckit::geometry::Point2> Points;
+    for (std::size_t j = 0; j < gridSize[1]; ++j)
+      for (std::size_t i = 0; i < gridSize[0]; ++i)
+        Points.emplace_back(lonRange[0] + (lonRange[1] - lonRange[0]) * i / gridSize[0],
+                            latRange[0] + (latRange[1] - latRange[0]) * j / gridSize[1]);
+    const std::size_t Gnlocs = Points.size();
+
+    std::vector<std::size_t> GlobalLocs(Gnlocs);
+    std::iota(GlobalLocs.begin(), GlobalLocs.end(), 0);
+    std::vector<bool> IsMine;
+    TestDist->assignRecords(GlobalLocs, GlobalLocs, Points, IsMine);
+
+    std::size_t Nlocs = std::count(IsMine.begin(), IsMine.end(), true);
+    std::size_t MinNlocs = Nlocs;
+    std::size_t MaxNlocs = Nlocs;
+    MpiComm.allReduceInPlace(Nlocs, eckit::mpi::sum());
+    MpiComm.allReduceInPlace(MinNlocs, eckit::mpi::min());
+    MpiComm.allReduceInPlace(MaxNlocs, eckit::mpi::max());
+    oops::Log::debug() << "Distribution::BalanceTests: min nlocs: " << MinNlocs
+                       << " max nlocs: " << MaxNlocs << std::endl;
+
+    EXPECT_EQUAL(Nlocs, Gnlocs);
+    const double MeanNlocs = static_cast<double>(Gnlocs) / MpiComm.size();
+    const double Tolerance = testConf.getDouble("max imbalance");
+    EXPECT(MaxNlocs <= (1.0 + Tolerance) * MeanNlocs);
+    EXPECT(MinNlocs >= (1.0 - Tolerance) * MeanNlocs);
+  }
+}
+
+// -----------------------------------------------------------------------------
+
 // This test can be used to test distributions that cannot be constructed by the
 // DistributionFactory, but need to be constructed by an ObsSpace. For example, the
 // MasterAndReplicaDistribution.
@@ -330,6 +404,8 @@ class Distribution : public oops::Test {
       { testConstructor(); });
     ts.emplace_back(CASE("distribution/Distribution/testDistributionConstructedManually")
       { testDistributionConstructedManually(); });
+    ts.emplace_back(CASE("distribution/Distribution/testDistributionBalance")
+      { testDistributionBalance(); });
     ts.emplace_back(CASE("distribution/Distribution/testDistributionConstructedByObsSpace")
       { testDistributionConstructedByObsSpace(); });
   }
@@ -105,6 +105,11 @@ void testFrameRead(ObsFrameRead & obsFrame, eckit::LocalConfiguration & obsConfi
         }
         iframe++;
     }
+
+    // Check that all of the frames were seen
+    if (obsConfig.has("number of frames")) {
+        EXPECT_EQUAL(iframe, obsConfig.getInt("number of frames"));
+    }
 }
 
 // -----------------------------------------------------------------------------
@@ -153,6 +158,16 @@ void testRead() {
         ioda::Dimensions_t maxVarSize = obsFrame.backendMaxVarSize();
         EXPECT_EQUAL(maxVarSize, expectedMaxVarSize);
 
+        // Check the frame size, which is derived from "max frame bytes" when given
+        if (testConfig.has("max frame size")) {
+            ioda::Dimensions_t expectedMaxFrameSize = testConfig.getInt("max frame size");
+            EXPECT_EQUAL(obsFrame.maxFrameSize(), expectedMaxFrameSize);
+        }
+
+        // Check the frame reading mode
+        bool expectedPrefetchFrames = testConfig.getBool("prefetch frames", false);
+        EXPECT_EQUAL(obsFrame.prefetchFrames(), expectedPrefetchFrames);
+
         // Test reading frames. Create a container for capturing the global attributes.
         Engines::BackendNames backendName;
         Engines::BackendCreationParameters backendParams;
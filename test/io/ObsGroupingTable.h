@@ -0,0 +1,293 @@
+/*
+ * (C) Copyright 2022 UCAR
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ */
+
+#ifndef TEST_IO_OBSGROUPINGTABLE_H_
+#define TEST_IO_OBSGROUPINGTABLE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+#define ECKIT_TESTING_SELF_REGISTER_CASES 0
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/testing/Test.h"
+
+#include "oops/runs/Test.h"
+#include "oops/test/TestEnvironment.h"
+#include "oops/util/Logger.h"
+
+#include "ioda/Exception.h"
+#include "ioda/io/ObsGroupingTable.h"
+
+namespace ioda {
+namespace test {
+
+// -----------------------------------------------------------------------------
+// Helper Functions
+// -----------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+/// Assign record numbers to the keys of a frame the way ObsFrameRead does: a key that is
+/// not in the table yet gets the next record number.
+std::vector<std::size_t> assignRecordNumbers(const ObsGroupingKeys & keys,
+                                             ObsGroupingTable & table,
+                                             std::size_t & nextRecNum) {
+    std::vector<std::size_t> recNums(keys.numLocs());
+    for (std::size_t i = 0; i < keys.numLocs(); ++i) {
+        std::size_t recNum = table.find(keys, i);
+        if (recNum == ObsGroupingTable::notFound) {
+            recNum = nextRecNum++;
+            table.insert(keys, i, recNum);
+        }
+        recNums[i] = recNum;
+    }
+    return recNums;
+}
+
+// -----------------------------------------------------------------------------
+/// Assign record numbers with the former obs grouping scheme, where the key of a location
+/// was the std::to_string forms of its grouping values joined by colons.
+std::vector<std::size_t> assignRecordNumbers(const std::vector<std::string> & stringKeys,
+                                             std::map<std::string, std::size_t> & table,
+                                             std::size_t & nextRecNum) {
+    std::vector<std::size_t> recNums(stringKeys.size());
+    for (std::size_t i = 0; i < stringKeys.size(); ++i) {
+        if (table.find(stringKeys[i]) == table.end()) {
+            table[stringKeys[i]] = nextRecNum++;
+        }
+        recNums[i] = table.at(stringKeys[i]);
+    }
+    return recNums;
+}
+
+// -----------------------------------------------------------------------------
+// Test Functions
+// -----------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+void testCollisions() {
+    // Pick keys that all start probing from the same slot of the initial table, so that
+    // they can only be told apart by walking the probe sequence and comparing the keys.
+    const std::size_t numCandidates = 100000;
+    std::vector<std::uint64_t> candidates(numCandidates);
+    for (std::size_t i = 0; i < numCandidates; ++i) {
+        candidates[i] = groupingKeySegment(static_cast<int64_t>(i));
+    }
+    ObsGroupingKeys candidateKeys;
+    candidateKeys.reset(numCandidates);
+    candidateKeys.appendNumericSegments(candidates);
+
+    const std::uint64_t slotMask = 1023;
+    const std::uint64_t targetSlot = candidateKeys.hash(0) & slotMask;
+    std::vector<std::uint64_t> collidingSegments;
+    for (std::size_t i = 0; (i < numCandidates) && (collidingSegments.size() < 9); ++i) {
+        if ((candidateKeys.hash(i) & slotMask) == targetSlot) {
+            collidingSegments.push_back(candidates[i]);
+        }
+    }
+    oops::Log::debug() << "testCollisions: number of colliding keys: "
+                       << collidingSegments.size() << std::endl;
+    EXPECT_EQUAL(collidingSegments.size(), 9u);
+
+    // Insert all but the last colliding key
+    ObsGroupingKeys keys;
+    keys.reset(collidingSegments.size());
+    keys.appendNumericSegments(collidingSegments);
+    ObsGroupingTable table;
+    for (std::size_t i = 0; i + 1 < keys.numLocs(); ++i) {
+        EXPECT_EQUAL(table.find(keys, i), ObsGroupingTable::notFound);
+        table.insert(keys, i, 10 * i);
+    }
+    EXPECT_EQUAL(table.size(), keys.numLocs() - 1);
+    for (std::size_t i = 0; i + 1 < keys.numLocs(); ++i) {
+        EXPECT_EQUAL(table.find(keys, i), 10 * i);
+    }
+    EXPECT_EQUAL(table.find(keys, keys.numLocs() - 1), ObsGroupingTable::notFound);
+
+    // Keys with the same first segment but a different second segment are different keys
+    keys.appendNumericSegments(std::vector<std::uint64_t>(keys.numLocs(), 1));
+    ObsGroupingTable twoSegmentTable;
+    twoSegmentTable.insert(keys, 0, 0);
+    ObsGroupingKeys otherKeys;
+    otherKeys.reset(1);
+    otherKeys.appendNumericSegments({ collidingSegments[0] });
+    otherKeys.appendNumericSegments({ 2 });
+    EXPECT_EQUAL(twoSegmentTable.find(otherKeys, 0), ObsGroupingTable::notFound);
+
+    // A key with a different layout cannot be added to the table
+    EXPECT_THROWS_AS(table.insert(otherKeys, 0, 0), ioda::Exception);
+}
+
+// -----------------------------------------------------------------------------
+void testGrowth() {
+    const eckit::LocalConfiguration conf(::test::TestEnvironment::config(), "growth");
+    const std::size_t numKeys = conf.getUnsigned("number of keys");
+    const std::size_t locsPerFrame = conf.getUnsigned("locations per frame");
+
+    // Insert the keys a frame at a time, so that the table grows several times while
+    // the keys of earlier frames are in it, then look all of them up again.
+    ObsGroupingTable table;
+    std::size_t nextRecNum = 0;
+    for (std::size_t frameStart = 0; frameStart < numKeys; frameStart += locsPerFrame) {
+        const std::size_t frameCount = std::min(locsPerFrame, numKeys - frameStart);
+        std::vector<std::uint64_t> segments(frameCount);
+        for (std::size_t i = 0; i < frameCount; ++i) {
+            segments[i] = groupingKeySegment(static_cast<int64_t>(frameStart + i));
+        }
+        ObsGroupingKeys keys;
+        keys.reset(frameCount);
+        keys.appendNumericSegments(segments);
+        std::vector<std::size_t> recNums = assignRecordNumbers(keys, table, nextRecNum);
+        for (std::size_t i = 0; i < frameCount; ++i) {
+            EXPECT_EQUAL(recNums[i], frameStart + i);
+        }
+    }
+    EXPECT_EQUAL(table.size(), numKeys);
+
+    std::vector<std::uint64_t> segments(numKeys);
+    for (std::size_t i = 0; i < numKeys; ++i) {
+        segments[i] = groupingKeySegment(static_cast<int64_t>(i));
+    }
+    ObsGroupingKeys keys;
+    keys.reset(numKeys);
+    keys.appendNumericSegments(segments);
+    for (std::size_t i = 0; i < numKeys; ++i) {
+        EXPECT_EQUAL(table.find(keys, i), i);
+    }
+}
+
+// -----------------------------------------------------------------------------
+void testFloatRounding() {
+    // Values straddling the sixth decimal place, exact ties at the sixth decimal place
+    // (1/128 and 3/128 scaled by 1.0e6 end in .5), signed zeros, large magnitudes and
+    // the non-finite values.
+    const std::vector<float> values = {
+        0.0f, -0.0f, 1.0e-7f, -1.0e-7f, 4.0e-7f, 6.0e-7f, 1.0e-6f, 1.4e-6f,
+        0.0078125f, 0.007812f, 0.007813f, 0.0234375f, 0.023437f, 0.023438f,
+        0.1f, 0.1000001f, 0.1000004f, 0.1000006f, 45.25f, 45.250001f,
+        123456.789f, 123456.79f, 1.0e10f, -1.0e10f, 3.4e38f, -3.4e38f,
+        std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::quiet_NaN(), -std::numeric_limits<float>::quiet_NaN()
+    };
+
+    // Two values give the same segment exactly when they have the same std::to_string form
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        for (std::size_t j = 0; j < values.size(); ++j) {
+            const bool sameString = (std::to_string(values[i]) == std::to_string(values[j]));
+            const bool sameSegment =
+                (groupingKeySegment(values[i]) == groupingKeySegment(values[j]));
+            if (sameString != sameSegment) {
+                oops::Log::info() << "testFloatRounding: mismatch for "
+                                  << std::to_string(values[i]) << " and "
+                                  << std::to_string(values[j]) << std::endl;
+            }
+            EXPECT_EQUAL(sameSegment, sameString);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void testMixedKeys() {
+    const eckit::LocalConfiguration conf(::test::TestEnvironment::config(), "mixed keys");
+    const std::size_t numLocs = conf.getUnsigned("number of locations");
+    const std::size_t locsPerFrame = conf.getUnsigned("locations per frame");
+
+    // Grouping variables of each supported type, with repeated values so that
+    // several locations share a record
+    const std::vector<std::string> stations = { "47646", "72520", "ABCD", "", "72520 " };
+    std::vector<std::string> stationIds(numLocs);
+    std::vector<int> flights(numLocs);
+    std::vector<float> pressures(numLocs);
+    std::vector<int64_t> dateTimes(numLocs);
+    std::vector<char> types(numLocs);
+    for (std::size_t i = 0; i < numLocs; ++i) {
+        stationIds[i] = stations[i % stations.size()];
+        flights[i] = static_cast<int>(i % 7) - 3;
+        pressures[i] = 0.25f * static_cast<float>(i % 4) +
+                       1.0e-7f * static_cast<float>(i % 3);
+        dateTimes[i] = 1523750400 + 3600 * static_cast<int64_t>(i % 6);
+        types[i] = static_cast<char>('a' + i % 2);
+    }
+
+    // Number the locations frame by frame with both schemes
+    ObsGroupingTable table;
+    std::size_t nextRecNum = 0;
+    std::map<std::string, std::size_t> stringTable;
+    std::size_t nextStringRecNum = 0;
+    for (std::size_t frameStart = 0; frameStart < numLocs; frameStart += locsPerFrame) {
+        const std::size_t frameCount = std::min(locsPerFrame, numLocs - frameStart);
+        std::vector<std::string> stationSegments(frameCount);
+        std::vector<std::uint64_t> flightSegments(frameCount);
+        std::vector<std::uint64_t> pressureSegments(frameCount);
+        std::vector<std::uint64_t> dateTimeSegments(frameCount);
+        std::vector<std::uint64_t> typeSegments(frameCount);
+        std::vector<std::string> stringKeys(frameCount);
+        for (std::size_t i = 0; i < frameCount; ++i) {
+            const std::size_t iloc = frameStart + i;
+            stationSegments[i] = stationIds[iloc];
+            flightSegments[i] = groupingKeySegment(flights[iloc]);
+            pressureSegments[i] = groupingKeySegment(pressures[iloc]);
+            dateTimeSegments[i] = groupingKeySegment(dateTimes[iloc]);
+            typeSegments[i] = groupingKeySegment(types[iloc]);
+            stringKeys[i] = stationIds[iloc] + ":" + std::to_string(flights[iloc]) + ":" +
+                            std::to_string(pressures[iloc]) + ":" +
+                            std::to_string(dateTimes[iloc]) + ":" + std::to_string(types[iloc]);
+        }
+        ObsGroupingKeys keys;
+        keys.reset(frameCount);
+        keys.appendStringSegments(std::move(stationSegments));
+        keys.appendNumericSegments(flightSegments);
+        keys.appendNumericSegments(pressureSegments);
+        keys.appendNumericSegments(dateTimeSegments);
+        keys.appendNumericSegments(typeSegments);
+        EXPECT_EQUAL(keys.numStringSegments(), 1u);
+        EXPECT_EQUAL(keys.numNumericSegments(), 4u);
+
+        std::vector<std::size_t> recNums = assignRecordNumbers(keys, table, nextRecNum);
+        std::vector<std::size_t> expectedRecNums =
+            assignRecordNumbers(stringKeys, stringTable, nextStringRecNum);
+        EXPECT(recNums == expectedRecNums);
+    }
+    oops::Log::debug() << "testMixedKeys: number of records: " << table.size() << std::endl;
+    EXPECT_EQUAL(table.size(), stringTable.size());
+}
+
+// -----------------------------------------------------------------------------
+
+class ObsGroupingTable : public oops::Test {
+ public:
+    ObsGroupingTable() {}
+    virtual ~ObsGroupingTable() {}
+ private:
+    std::string testid() const override {return "test::ObsGroupingTable";}
+
+    void register_tests() const override {
+        std::vector<eckit::testing::Test>& ts = eckit::testing::specification();
+
+        ts.emplace_back(CASE("ioda/ObsGroupingTable/testCollisions")
+            { testCollisions(); });
+        ts.emplace_back(CASE("ioda/ObsGroupingTable/testGrowth")
+            { testGrowth(); });
+        ts.emplace_back(CASE("ioda/ObsGroupingTable/testFloatRounding")
+            { testFloatRounding(); });
+        ts.emplace_back(CASE("ioda/ObsGroupingTable/testMixedKeys")
+            { testMixedKeys(); });
+    }
+
+    void clear() const override {}
+};
+
+// -----------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace ioda
+
+#endif  // TEST_IO_OBSGROUPINGTABLE_H_
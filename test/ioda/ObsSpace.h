@@ -8,6 +8,7 @@
 #ifndef TEST_IODA_OBSSPACE_H_
 #define TEST_IODA_OBSSPACE_H_
 
+#include <algorithm>
 #include <cmath>
 #include <set>
 #include <string>
@@ -53,8 +54,26 @@ class ObsSpaceTestFixture : private boost::noncopyable {
   static std::size_t size() {return getInstance().ospaces_.size();}
   static void cleanup() {
     auto &spaces = getInstance().ospaces_;
+    // Start all of the saves before waiting for any of them so that the asynchronous
+    // saves overlap.
+    for (std::size_t jj = 0; jj < spaces.size(); ++jj) {
+      spaces[jj]->save();
+
+      // Make sure that an asynchronous save did not fall back to a synchronous one,
+      // unless the MPI or HDF5 library does not allow it.
+      const eckit::LocalConfiguration testConfig(config(jj), "test data");
+      if (testConfig.getBool("asynchronous save", false)) {
+        if (ioda::ObsSpace::asyncSaveSupported()) {
+          EXPECT(spaces[jj]->saveInProgress());
+        } else {
+          oops::Log::warning() << "SKIPPED: check of the asynchronous save of "
+                               << spaces[jj]->obsname() << ", MPI_THREAD_MULTIPLE or"
+                               << " a thread safe HDF5 library is not available" << std::endl;
+        }
+      }
+    }
     for (auto &space : spaces) {
-      space->save();
+      space->waitForSave();
       space.reset();
     }
   }
@@ -179,6 +198,33 @@ void testConstructor() {
 
     EXPECT(odb.get_dim_id("nlocs") == ioda::ObsDimensionId::Nlocs);
     EXPECT(odb.get_dim_id("nchans") == ioda::ObsDimensionId::Nchans);
+
+    // Check whether the distribution was taken from the distribution cache, in which case
+    // it is the very same object as the one of an earlier obs space
+    std::vector<std::string> SameDistObsSpaces;
+    if (testConfig.has("same distribution as")) {
+      SameDistObsSpaces = testConfig.getStringVector("same distribution as");
+    }
+    std::vector<std::string> DifferentDistObsSpaces;
+    if (testConfig.has("different distribution from")) {
+      DifferentDistObsSpaces = testConfig.getStringVector("different distribution from");
+    }
+    for (std::size_t kk = 0; kk < Test_::size(); ++kk) {
+      const ObsSpace &otherOdb = Test_::obspace(kk);
+      const std::string &otherName = otherOdb.obsname();
+      if (std::find(SameDistObsSpaces.begin(), SameDistObsSpaces.end(), otherName) !=
+          SameDistObsSpaces.end()) {
+        oops::Log::debug() << odb.obsname() << ": expecting the distribution of "
+                           << otherName << std::endl;
+        EXPECT(odb.distribution() == otherOdb.distribution());
+      }
+      if (std::find(DifferentDistObsSpaces.begin(), DifferentDistObsSpaces.end(), otherName) !=
+          DifferentDistObsSpaces.end()) {
+        oops::Log::debug() << odb.obsname() << ": not expecting the distribution of "
+                           << otherName << std::endl;
+        EXPECT(odb.distribution() != otherOdb.distribution());
+      }
+    }
   }
 }
 
@@ -0,0 +1,388 @@
+/*
+ * (C) Copyright 2022 UCAR
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ */
+
+#ifndef TEST_IODA_OBSSPACEREADMODES_H_
+#define TEST_IODA_OBSSPACEREADMODES_H_
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define ECKIT_TESTING_SELF_REGISTER_CASES 0
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/testing/Test.h"
+
+#include "oops/mpi/mpi.h"
+#include "oops/runs/Test.h"
+#include "oops/test/TestEnvironment.h"
+#include "oops/util/DateTime.h"
+#include "oops/util/Duration.h"
+#include "oops/util/FloatCompare.h"
+#include "oops/util/Logger.h"
+
+#include "ioda/Engines/EngineUtils.h"
+#include "ioda/IodaTrait.h"
+#include "ioda/ObsGroup.h"
+#include "ioda/ObsSpace.h"
+
+namespace ioda {
+namespace test {
+
+// -----------------------------------------------------------------------------
+// Helper Functions
+// -----------------------------------------------------------------------------
+
+// The input file holds one variable, airTemperature, in each of the groups listed in the
+// "input file" configuration. Its value at each location is derived from the latitude so
+// that every process can check the values it receives, whatever the MPI distribution.
+float generatedValue(const float lat, const std::size_t groupNumber) {
+  return 100.0f * groupNumber + lat;
+}
+
+// -----------------------------------------------------------------------------
+void createInputFile(const eckit::LocalConfiguration & fileConfig) {
+  const std::string fileName = fileConfig.getString("name");
+  const int numLocs = fileConfig.getInt("nlocs");
+  const int locsPerRecord = fileConfig.getInt("locations per record");
+  const std::vector<std::string> groupNames = fileConfig.getStringVector("variable groups");
+
+  // Write to a temporary file first and then move it into place, so that instances of
+  // this test running at the same time never read a partially written file.
+  const std::string tempFileName = fileName + ".tmp" + std::to_string(getpid());
+  {
+    Engines::BackendCreationParameters backendParams;
+    backendParams.fileName = tempFileName;
+    backendParams.action = Engines::BackendFileActions::Create;
+    backendParams.createMode = Engines::BackendCreateModes::Truncate_If_Exists;
+    Group backend = constructBackend(Engines::BackendNames::Hdf5File, backendParams);
+
+    NewDimensionScales_t newDims;
+    newDims.push_back(NewDimensionScale<int>("nlocs", numLocs, numLocs, numLocs));
+    ObsGroup og = ObsGroup::generate(backend, newDims);
+    Variable nlocsVar = og.vars["nlocs"];
+
+    std::vector<float> lats(numLocs);
+    std::vector<float> lons(numLocs);
+    std::vector<int64_t> dts(numLocs);
+    std::vector<int> recNums(numLocs);
+    for (int i = 0; i < numLocs; ++i) {
+      lats[i] = -80.0f + (160.0f * i) / numLocs;
+      lons[i] = static_cast<float>((37 * i) % 360);
+      dts[i] = (i % 120) * 60 - 3600;
+      recNums[i] = i / locsPerRecord;
+    }
+
+    VariableCreationParameters floatParams;
+    floatParams.setFillValue<float>(-999.0f);
+    VariableCreationParameters intParams;
+    intParams.setFillValue<int>(-999);
+    VariableCreationParameters int64Params;
+    int64Params.setFillValue<int64_t>(-999);
+
+    og.vars.createWithScales<float>("MetaData/latitude", {nlocsVar}, floatParams)
+        .write<float>(lats);
+    og.vars.createWithScales<float>("MetaData/longitude", {nlocsVar}, floatParams)
+        .write<float>(lons);
+    og.vars.createWithScales<int64_t>("MetaData/dateTime", {nlocsVar}, int64Params)
+        .write<int64_t>(dts)
+        .atts.add<std::string>("units", std::string("seconds since 2018-04-15T00:00:00Z"));
+    og.vars.createWithScales<int>("MetaData/record_number", {nlocsVar}, intParams)
+        .write<int>(recNums);
+
+    // Also hold the legacy string representation of the datetimes, which the ObsSpace
+    // ignores since MetaData/dateTime is present
+    const util::DateTime epoch("2018-04-15T00:00:00Z");
+    std::vector<std::string> dtStrings(numLocs);
+    for (int i = 0; i < numLocs; ++i) {
+      dtStrings[i] = (epoch + util::Duration(dts[i])).toString();
+    }
+    VariableCreationParameters stringParams;
+    stringParams.setFillValue<std::string>("");
+    og.vars.createWithScales<std::string>("MetaData/datetime", {nlocsVar}, stringParams)
+        .write<std::string>(dtStrings);
+
+    for (std::size_t j = 0; j < groupNames.size(); ++j) {
+      std::vector<float> values(numLocs);
+      for (int i = 0; i < numLocs; ++i) {
+        values[i] = generatedValue(lats[i], j);
+      }
+      og.vars.createWithScales<float>(groupNames[j] + "/airTemperature", {nlocsVar},
+                                      floatParams)
+          .write<float>(values);
+    }
+  }
+  std::rename(tempFileName.c_str(), fileName.c_str());
+}
+
+// -----------------------------------------------------------------------------
+
+class ObsSpaceTestFixture : private boost::noncopyable {
+ public:
+  static ioda::ObsSpace & obspace(const std::size_t ii) {
+    return *getInstance().ospaces_.at(ii);
+  }
+  static std::size_t size() {return getInstance().ospaces_.size();}
+  static void cleanup() {
+    auto &spaces = getInstance().ospaces_;
+    for (auto &space : spaces) {
+      space.reset();
+    }
+  }
+
+ private:
+  static ObsSpaceTestFixture & getInstance() {
+    static ObsSpaceTestFixture theObsSpaceTestFixture;
+    return theObsSpaceTestFixture;
+  }
+
+  ObsSpaceTestFixture(): ospaces_() {
+    util::DateTime bgn(::test::TestEnvironment::config().getString("window begin"));
+    util::DateTime end(::test::TestEnvironment::config().getString("window end"));
+
+    // Create the input file on one process before any of the obs spaces read it
+    if (oops::mpi::world().rank() == 0) {
+      createInputFile(eckit::LocalConfiguration(::test::TestEnvironment::config(),
+                                                "input file"));
+    }
+    oops::mpi::world().barrier();
+
+    std::vector<eckit::LocalConfiguration> conf;
+    ::test::TestEnvironment::config().get("observations", conf);
+
+    for (std::size_t jj = 0; jj < conf.size(); ++jj) {
+      eckit::LocalConfiguration obsconf(conf[jj], "obs space");
+      ioda::ObsTopLevelParameters obsparams;
+      obsparams.validateAndDeserialize(obsconf);
+      boost::shared_ptr<ioda::ObsSpace> tmp(new ioda::ObsSpace(obsparams, oops::mpi::world(),
+                                                               bgn, end, oops::mpi::myself()));
+      ospaces_.push_back(tmp);
+    }
+  }
+
+  ~ObsSpaceTestFixture() {}
+
+  std::vector<boost::shared_ptr<ioda::ObsSpace> > ospaces_;
+};
+
+// -----------------------------------------------------------------------------
+
+void testConstructor() {
+  typedef ObsSpaceTestFixture Test_;
+
+  std::vector<eckit::LocalConfiguration> conf;
+  ::test::TestEnvironment::config().get("observations", conf);
+
+  for (std::size_t jj = 0; jj < Test_::size(); ++jj) {
+    eckit::LocalConfiguration testConfig;
+    conf[jj].get("test data", testConfig);
+
+    const ObsSpace &odb = Test_::obspace(jj);
+    std::size_t GlobalNlocs = odb.globalNumLocs();
+    std::size_t ExpectedGlobalNlocs = testConfig.getUnsigned("nlocs");
+    oops::Log::debug() << odb.obsname() << ": GlobalNlocs, ExpectedGlobalNlocs: "
+                       << GlobalNlocs << ", " << ExpectedGlobalNlocs << std::endl;
+    EXPECT_EQUAL(GlobalNlocs, ExpectedGlobalNlocs);
+
+    std::size_t NumIngestThreads = odb.numIngestThreads();
+    std::size_t ExpectedNumIngestThreads = testConfig.getUnsigned("ingest threads", 1);
+    EXPECT_EQUAL(NumIngestThreads, ExpectedNumIngestThreads);
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+void testVariableSelection() {
+  typedef ObsSpaceTestFixture Test_;
+
+  std::vector<eckit::LocalConfiguration> conf;
+  ::test::TestEnvironment::config().get("observations", conf);
+
+  for (std::size_t jj = 0; jj < Test_::size(); ++jj) {
+    eckit::LocalConfiguration testConfig;
+    conf[jj].get("test data", testConfig);
+    const ObsSpace &odb = Test_::obspace(jj);
+
+    // Variables given as group/name
+    std::vector<std::string> presentVars;
+    if (testConfig.has("present variables")) {
+      presentVars = testConfig.getStringVector("present variables");
+    }
+    for (auto & varName : presentVars) {
+      const std::size_t pos = varName.find('/');
+      oops::Log::debug() << odb.obsname() << ": expecting " << varName << std::endl;
+      EXPECT(odb.has(varName.substr(0, pos), varName.substr(pos + 1)));
+    }
+
+    std::vector<std::string> absentVars;
+    if (testConfig.has("absent variables")) {
+      absentVars = testConfig.getStringVector("absent variables");
+    }
+    for (auto & varName : absentVars) {
+      const std::size_t pos = varName.find('/');
+      oops::Log::debug() << odb.obsname() << ": not expecting " << varName << std::endl;
+      EXPECT_NOT(odb.has(varName.substr(0, pos), varName.substr(pos + 1)));
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+void testDeferredReads() {
+  typedef ObsSpaceTestFixture Test_;
+
+  eckit::LocalConfiguration fileConfig(::test::TestEnvironment::config(), "input file");
+  const std::vector<std::string> groupNames = fileConfig.getStringVector("variable groups");
+
+  std::vector<eckit::LocalConfiguration> conf;
+  ::test::TestEnvironment::config().get("observations", conf);
+
+  for (std::size_t jj = 0; jj < Test_::size(); ++jj) {
+    eckit::LocalConfiguration testConfig;
+    conf[jj].get("test data", testConfig);
+    const ObsSpace &odb = Test_::obspace(jj);
+    const std::size_t Nlocs = odb.nlocs();
+
+    // The location metadata are always read while the ObsSpace is constructed
+    EXPECT_NOT(odb.isDeferred("MetaData", "latitude"));
+
+    // Groups whose airTemperature read is expected to be deferred by lazy loading
+    std::vector<std::string> deferredGroups;
+    if (testConfig.has("deferred groups")) {
+      deferredGroups = testConfig.getStringVector("deferred groups");
+    }
+
+    // The legacy datetime is not stored in the ObsSpace, so it is not deferred either
+    EXPECT_NOT(odb.has("MetaData", "datetime"));
+    EXPECT_NOT(odb.isDeferred("MetaData", "datetime"));
+
+    // Saving reads all of the deferred variables into the ObsSpace container
+    if (testConfig.getBool("save", false)) {
+      for (auto & groupName : deferredGroups) {
+        EXPECT(odb.isDeferred(groupName, "airTemperature"));
+      }
+      Test_::obspace(jj).save();
+      for (auto & groupName : deferredGroups) {
+        EXPECT_NOT(odb.isDeferred(groupName, "airTemperature"));
+      }
+    }
+
+    std::vector<float> lats(Nlocs);
+    odb.get_db("MetaData", "latitude", lats);
+
+    for (auto & groupName : deferredGroups) {
+      const std::size_t groupNumber =
+          std::find(groupNames.begin(), groupNames.end(), groupName) - groupNames.begin();
+      oops::Log::debug() << odb.obsname() << ": checking the deferred read of " << groupName
+                         << "/airTemperature" << std::endl;
+      EXPECT(groupNumber < groupNames.size());
+      EXPECT(odb.isDeferred(groupName, "airTemperature") != testConfig.getBool("save", false));
+
+      // The first access reads the variable, which then holds the same values as an
+      // eager read would
+      std::vector<float> values(Nlocs);
+      odb.get_db(groupName, "airTemperature", values, { }, true);
+      EXPECT_NOT(odb.isDeferred(groupName, "airTemperature"));
+      for (std::size_t i = 0; i < Nlocs; ++i) {
+        EXPECT(oops::is_close(values[i], generatedValue(lats[i], groupNumber), 1.0e-6f));
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+void testVariableValues() {
+  typedef ObsSpaceTestFixture Test_;
+
+  eckit::LocalConfiguration fileConfig(::test::TestEnvironment::config(), "input file");
+  const std::vector<std::string> groupNames = fileConfig.getStringVector("variable groups");
+
+  std::vector<eckit::LocalConfiguration> conf;
+  ::test::TestEnvironment::config().get("observations", conf);
+
+  for (std::size_t jj = 0; jj < Test_::size(); ++jj) {
+    eckit::LocalConfiguration testConfig;
+    conf[jj].get("test data", testConfig);
+    const ObsSpace &odb = Test_::obspace(jj);
+    const std::size_t Nlocs = odb.nlocs();
+
+    // The groups to check default to all of the groups in the input file
+    std::vector<std::string> checkedGroups = groupNames;
+    if (testConfig.has("checked groups")) {
+      checkedGroups = testConfig.getStringVector("checked groups");
+    }
+
+    std::vector<float> lats(Nlocs);
+    odb.get_db("MetaData", "latitude", lats);
+
+    // Each location held on this process needs the values of that same location in
+    // every group, regardless of the order in which the groups are read.
+    for (auto & groupName : checkedGroups) {
+      const std::size_t groupNumber =
+          std::find(groupNames.begin(), groupNames.end(), groupName) - groupNames.begin();
+      oops::Log::debug() << odb.obsname() << ": checking " << groupName
+                         << "/airTemperature" << std::endl;
+      EXPECT(groupNumber < groupNames.size());
+      // skipDerived so that ObsValue is not read from DerivedObsValue
+      EXPECT(odb.has(groupName, "airTemperature", true));
+      std::vector<float> values(Nlocs);
+      odb.get_db(groupName, "airTemperature", values, { }, true);
+      for (std::size_t i = 0; i < Nlocs; ++i) {
+        EXPECT(oops::is_close(values[i], generatedValue(lats[i], groupNumber), 1.0e-6f));
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+void testCleanup() {
+  typedef ObsSpaceTestFixture Test_;
+
+  Test_::cleanup();
+}
+
+// -----------------------------------------------------------------------------
+
+class ObsSpaceReadModes : public oops::Test {
+ public:
+  ObsSpaceReadModes() {}
+  virtual ~ObsSpaceReadModes() {}
+ private:
+  std::string testid() const override {return "test::ObsSpaceReadModes<ioda::IodaTrait>";}
+
+  void register_tests() const override {
+    std::vector<eckit::testing::Test>& ts = eckit::testing::specification();
+
+    ts.emplace_back(CASE("ioda/ObsSpaceReadModes/testConstructor")
+      { testConstructor(); });
+    ts.emplace_back(CASE("ioda/ObsSpaceReadModes/testVariableSelection")
+      { testVariableSelection(); });
+    ts.emplace_back(CASE("ioda/ObsSpaceReadModes/testDeferredReads")
+      { testDeferredReads(); });
+    ts.emplace_back(CASE("ioda/ObsSpaceReadModes/testVariableValues")
+      { testVariableValues(); });
+    ts.emplace_back(CASE("ioda/ObsSpaceReadModes/testCleanup")
+      { testCleanup(); });
+  }
+
+  void clear() const override {}
+};
+
+// -----------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace ioda
+
+#endif  // TEST_IODA_OBSSPACEREADMODES_H_
@@ -28,6 +28,7 @@
 #include "oops/util/dot_product.h"
 #include "oops/util/Logger.h"
 
+#include "ioda/distribution/DistributionUtils.h"
 #include "ioda/IodaTrait.h"
 #include "ioda/ObsSpace.h"
 #include "ioda/ObsVector.h"
@@ -267,6 +268,20 @@ void testDotProduct() {
     // test that dot products are consistent (sum of all elements in multivar one
     // is the same as the scalar one)
     EXPECT(oops::is_close(dp1, std::accumulate(dp2.begin(), dp2.end(), 0.0), 1.0e-12));
+
+    // test that the non-blocking reductions give the same results as the blocking ones
+    const ioda::Distribution & dist = *obspace.distribution();
+    std::vector<double> values1(vec1.size());
+    std::vector<double> values2(vec2.size());
+    for (std::size_t i = 0; i < vec1.size(); ++i) {
+      values1[i] = vec1[i];
+      values2[i] = vec2[i];
+    }
+    ioda::PendingReduction<double> dp3 = ioda::iDotProduct(dist, vec1.nvars(), values1, values2);
+    ioda::PendingReduction<std::vector<double>> dp4 =
+        ioda::iDotProductPerVariable(dist, vec1.nvars(), values1, values2);
+    EXPECT_EQUAL(dp3.get(), dp1);
+    EXPECT_EQUAL(dp4.get(), dp2);
   }
 }
 